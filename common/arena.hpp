@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+namespace arena
+{
+
+	struct Stats
+	{
+		// Requests made by the containers living in the arena.
+		size_t allocations = 0;
+		size_t bytes = 0;
+		// Blocks the arena took from the heap to serve them.
+		size_t chunks = 0;
+		size_t chunk_bytes = 0;
+	};
+
+	// Forwards to another resource, counting what passes through.
+	class CountingResource : public std::pmr::memory_resource
+	{
+	  public:
+		explicit CountingResource( std::pmr::memory_resource *upstream )
+		    : upstream_( upstream )
+		{
+		}
+
+		size_t allocations() const { return allocations_; }
+		size_t bytes() const { return bytes_; }
+
+	  private:
+		void *do_allocate( size_t bytes, size_t alignment ) override
+		{
+			++allocations_;
+			bytes_ += bytes;
+			return upstream_->allocate( bytes, alignment );
+		}
+
+		void do_deallocate( void *p, size_t bytes, size_t alignment ) override
+		{
+			upstream_->deallocate( p, bytes, alignment );
+		}
+
+		bool do_is_equal( const std::pmr::memory_resource &other ) const noexcept override { return this == &other; }
+
+		std::pmr::memory_resource *upstream_;
+		size_t allocations_ = 0;
+		size_t bytes_ = 0;
+	};
+
+	// Bump allocator: allocations are carved out of large heap chunks, deallocation is a no-op, and everything is
+	// handed back at once when the arena is destroyed. Not thread-safe; one arena per parse.
+	class Arena
+	{
+	  public:
+		// initial_size sizes the first chunk; later chunks grow geometrically. The input size is a good guess.
+		explicit Arena( size_t initial_size = 64 * 1024 )
+		    : heap_( std::pmr::new_delete_resource() )
+		    , bump_( std::max<size_t>( initial_size, 1 ), &heap_ )
+		    , requests_( &bump_ )
+		{
+		}
+
+		Arena( const Arena & ) = delete;
+		Arena &operator=( const Arena & ) = delete;
+
+		std::pmr::memory_resource *resource() { return &requests_; }
+
+		Stats stats() const
+		{
+			return { requests_.allocations(), requests_.bytes(), heap_.allocations(), heap_.bytes() };
+		}
+
+	  private:
+		CountingResource heap_;
+		std::pmr::monotonic_buffer_resource bump_;
+		CountingResource requests_;
+	};
+
+	// A parse result together with the arena its containers allocate from, so the whole result is freed in one
+	// step. T should use std::pmr containers built on the resource handed to the parse function:
+	//
+	//     arena::Region<Packs> packs( input.size(), [&]( std::pmr::memory_resource *resource ) {
+	//         return parseFile( input, resource );
+	//     } );
+	template <typename T> class Region
+	{
+	  public:
+		Region() = default;
+
+		template <typename Parse>
+		Region( size_t initial_size, Parse &&parse )
+		    : arena_( std::make_unique<Arena>( initial_size ) )
+		{
+			value_.emplace( std::forward<Parse>( parse )( arena_->resource() ) );
+		}
+
+		Region( Region &&other ) noexcept = default;
+
+		// The value has to go before its arena, and the incoming value keeps pointing into the incoming arena.
+		Region &operator=( Region &&other ) noexcept
+		{
+			if( this != &other )
+			{
+				value_.reset();
+				arena_ = std::move( other.arena_ );
+				if( other.value_ )
+				{
+					value_.emplace( std::move( *other.value_ ) );
+					other.value_.reset();
+				}
+			}
+			return *this;
+		}
+
+		T &operator*() { return *value_; }
+		const T &operator*() const { return *value_; }
+		T *operator->() { return &*value_; }
+		const T *operator->() const { return &*value_; }
+
+		std::optional<Stats> stats() const { return arena_ ? std::optional( arena_->stats() ) : std::nullopt; }
+
+	  private:
+		std::unique_ptr<Arena> arena_;
+		// Declared after the arena, so it is destroyed first.
+		std::optional<T> value_;
+	};
+
+} // namespace arena
@@ -3,6 +3,7 @@
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -77,6 +78,35 @@ namespace args
 						return std::nullopt;
 					}
 				}
+				else if constexpr( std::is_integral_v<T> )
+				{
+					try
+					{
+						if constexpr( std::is_signed_v<T> )
+						{
+							return static_cast<T>( std::stoll( it->second ) );
+						}
+						else
+						{
+							return static_cast<T>( std::stoull( it->second ) );
+						}
+					}
+					catch( const std::logic_error & )
+					{
+						return std::nullopt;
+					}
+				}
+				else if constexpr( std::is_floating_point_v<T> )
+				{
+					try
+					{
+						return static_cast<T>( std::stod( it->second ) );
+					}
+					catch( const std::logic_error & )
+					{
+						return std::nullopt;
+					}
+				}
 			}
 			return std::nullopt;
 		}
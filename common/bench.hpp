@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <print>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <args.hpp>
+#include <memory.hpp>
+#include <profiler.hpp>
+
+namespace bench
+{
+
+	// Makes the optimizer assume value is read, so the work that produced it cannot be discarded.
+	template <typename T> inline void do_not_optimize( const T &value )
+	{
+#if defined( __clang__ ) || defined( __GNUC__ )
+		asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+		(void)value;
+		std::atomic_signal_fence( std::memory_order_seq_cst );
+#endif
+	}
+
+	struct Stats
+	{
+		std::string phase;
+		size_t iterations = 0;
+		double min = 0;
+		double median = 0;
+		double p99 = 0;
+		double mean = 0;
+	};
+
+	// Samples in nanoseconds; sorted in place.
+	inline Stats summarize( std::string_view phase, std::vector<double> &samples )
+	{
+		std::ranges::sort( samples );
+		Stats stats;
+		stats.phase = phase;
+		stats.iterations = samples.size();
+		if( samples.empty() )
+			return stats;
+
+		const size_t n = samples.size();
+		stats.min = samples.front();
+		stats.median = n % 2 == 1 ? samples[n / 2] : ( samples[n / 2 - 1] + samples[n / 2] ) / 2;
+		stats.p99 = samples[static_cast<size_t>( std::ceil( 0.99 * n ) ) - 1];
+		for( double sample : samples )
+		{
+			stats.mean += sample / n;
+		}
+		return stats;
+	}
+
+	// Times the phases of a solution when --bench <iterations> is given, and is a plain call otherwise.
+	// With --profile <report.json>, the returning call of every phase is also recorded by a profile::Profiler, and
+	// with --memory its heap use by a memory::Tracker.
+	//
+	//     bench::Session session( parser );
+	//     auto input = session.measure( "parse", [&] { return parse( file ); } );
+	//     ...
+	//     session.report();
+	class Session
+	{
+	  public:
+		// The name labels the report when several sessions run in one process, e.g. one per day.
+		explicit Session( const args::Parser &parser, std::string_view name = {} )
+		    : name_( name )
+		    , iterations_( static_cast<size_t>( std::max( parser.get<int>( "bench" ).value_or( 0 ), 0 ) ) )
+		    , warmup_( std::max<size_t>( iterations_ / 10, 1 ) )
+		    , profiler_( parser, name )
+		    , memory_( parser, name )
+		{
+		}
+
+		bool enabled() const { return iterations_ > 0; }
+
+		// Returns f(). When benchmarking, f also runs warmup and timed iterations first, so it must be
+		// repeatable: it should not consume or mutate its inputs.
+		template <typename F> std::invoke_result_t<F &> measure( std::string_view phase, F &&f )
+		{
+			if( enabled() )
+			{
+				for( size_t i = 0; i < warmup_; ++i )
+				{
+					run( f );
+				}
+
+				std::vector<double> samples;
+				samples.reserve( iterations_ );
+				for( size_t i = 0; i < iterations_; ++i )
+				{
+					auto start = std::chrono::steady_clock::now();
+					run( f );
+					auto end = std::chrono::steady_clock::now();
+					samples.push_back( std::chrono::duration<double, std::nano>( end - start ).count() );
+				}
+				results_.push_back( summarize( phase, samples ) );
+			}
+			auto memory_scope = memory_.scope( phase );
+			auto scope = profiler_.scope( phase );
+			return f();
+		}
+
+		const std::vector<Stats> &results() const { return results_; }
+
+		profile::Profiler &profiler() { return profiler_; }
+
+		void report() const
+		{
+			memory_.report();
+			if( !enabled() )
+				return;
+
+			std::println( "" );
+			std::println(
+			    "Benchmark{}{}: {} iterations after {} warmup runs (µs)", name_.empty() ? "" : " ", name_, iterations_,
+			    warmup_ );
+			std::println( "{:<16} {:>12} {:>12} {:>12} {:>12}", "phase", "min", "median", "p99", "mean" );
+			for( const auto &stats : results_ )
+			{
+				std::println(
+				    "{:<16} {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f}", stats.phase, stats.min / 1e3, stats.median / 1e3,
+				    stats.p99 / 1e3, stats.mean / 1e3 );
+			}
+		}
+
+	  private:
+		template <typename F> static void run( F &f )
+		{
+			if constexpr( std::is_void_v<std::invoke_result_t<F &>> )
+			{
+				f();
+			}
+			else
+			{
+				auto result = f();
+				do_not_optimize( result );
+			}
+		}
+
+		std::string name_;
+		size_t iterations_;
+		size_t warmup_;
+		std::vector<Stats> results_;
+		profile::Profiler profiler_;
+		memory::Tracker memory_;
+	};
+
+} // namespace bench
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <reader.hpp>
+
+namespace cache
+{
+
+	// Bumped whenever the file layout below changes; each solver versions its own sections separately.
+	inline constexpr uint32_t format_version = 1;
+
+	// 64-bit content hash in the style of xxHash64: four independent lanes over 8-byte words, so it runs at close to
+	// memory bandwidth, folded together with the length. Not cryptographic; it only tells inputs apart.
+	inline uint64_t hash( std::string_view data )
+	{
+		constexpr uint64_t prime1 = 0x9E3779B185EBCA87;
+		constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+		constexpr uint64_t prime3 = 0x165667B19E3779F9;
+		auto round = []( uint64_t acc, uint64_t word ) { return std::rotl( acc + word * prime2, 31 ) * prime1; };
+		auto word_at = []( const char *p ) {
+			uint64_t word;
+			std::memcpy( &word, p, sizeof( word ) );
+			return word;
+		};
+
+		std::array<uint64_t, 4> lanes = { prime1 + prime2, prime2, 0, 0 - prime1 };
+		size_t i = 0;
+		for( ; i + 32 <= data.size(); i += 32 )
+		{
+			for( size_t lane = 0; lane < lanes.size(); ++lane )
+			{
+				lanes[lane] = round( lanes[lane], word_at( data.data() + i + 8 * lane ) );
+			}
+		}
+
+		uint64_t h = std::rotl( lanes[0], 1 ) + std::rotl( lanes[1], 7 ) + std::rotl( lanes[2], 12 ) +
+		             std::rotl( lanes[3], 18 ) + data.size();
+		for( ; i + 8 <= data.size(); i += 8 )
+		{
+			h = std::rotl( h ^ round( 0, word_at( data.data() + i ) ), 27 ) * prime1 + prime3;
+		}
+		if( i < data.size() )
+		{
+			uint64_t tail = 0;
+			std::memcpy( &tail, data.data() + i, data.size() - i );
+			h = std::rotl( h ^ round( 0, tail ), 27 ) * prime1 + prime3;
+		}
+
+		h ^= h >> 33;
+		h *= prime2;
+		h ^= h >> 29;
+		h *= prime3;
+		h ^= h >> 32;
+		return h;
+	}
+
+	// File layout: a Header, a table of Sections, then the section data, each starting on a 64-byte boundary so
+	// any type can be read in place. Values are in the byte order of the machine that wrote them, and byte_order
+	// rejects a file written with the other one.
+	struct Header
+	{
+		std::array<char, 8> magic = { 'A', 'O', 'C', 'C', 'A', 'C', 'H', 'E' };
+		uint32_t byte_order = 0x01020304;
+		uint32_t format = format_version;
+		uint32_t layout = 0;
+		uint32_t sections = 0;
+		uint64_t input_hash = 0;
+		uint64_t input_size = 0;
+	};
+
+	struct Section
+	{
+		uint64_t offset = 0;
+		uint64_t bytes = 0;
+	};
+
+	inline constexpr size_t section_alignment = 64;
+
+	// Types stored byte for byte. A std::pair of them counts as well: it is only kept from being trivially copyable
+	// by its assignment operator.
+	template <typename T> inline constexpr bool is_flat_v = std::is_trivially_copyable_v<T>;
+	template <typename A, typename B>
+	inline constexpr bool is_flat_v<std::pair<A, B>> = is_flat_v<A> && is_flat_v<B>;
+
+	template <typename T>
+	concept Flat = is_flat_v<T>;
+
+	// Collects a parse result as sections of Flat values and writes them out. Sections are kept as views, so what
+	// they point at has to stay alive until write().
+	class Writer
+	{
+	  public:
+		template <Flat T>
+		void add( std::span<const T> values )
+		{
+			sections_.push_back( std::as_bytes( values ) );
+		}
+
+		template <Flat T>
+		void add_value( const T &value )
+		{
+			add( std::span<const T>( &value, 1 ) );
+		}
+
+		// Writes to a temporary file and renames it into place, so a reader never sees half a cache. Best effort:
+		// false if the file could not be written, e.g. next to an input in a read-only directory.
+		bool write( const std::filesystem::path &path, uint32_t layout, uint64_t input_hash, uint64_t input_size ) const
+		{
+			Header header;
+			header.layout = layout;
+			header.sections = static_cast<uint32_t>( sections_.size() );
+			header.input_hash = input_hash;
+			header.input_size = input_size;
+
+			std::vector<Section> table( sections_.size() );
+			uint64_t offset = align( sizeof( Header ) + table.size() * sizeof( Section ) );
+			for( size_t i = 0; i < sections_.size(); ++i )
+			{
+				table[i] = { offset, sections_[i].size() };
+				offset = align( offset + sections_[i].size() );
+			}
+
+			std::filesystem::path temporary = path;
+			temporary += ".tmp";
+			bool complete = false;
+			{
+				std::ofstream file( temporary, std::ios::out | std::ios::binary | std::ios::trunc );
+				uint64_t written = 0;
+				auto put = [&]( const void *data, size_t bytes ) {
+					file.write( static_cast<const char *>( data ), static_cast<std::streamsize>( bytes ) );
+					written += bytes;
+				};
+				auto pad_to = [&]( uint64_t position ) {
+					constexpr std::array<char, section_alignment> zeros{};
+					put( zeros.data(), position - written );
+				};
+				put( &header, sizeof( header ) );
+				put( table.data(), table.size() * sizeof( Section ) );
+				for( size_t i = 0; i < sections_.size(); ++i )
+				{
+					pad_to( table[i].offset );
+					put( sections_[i].data(), sections_[i].size() );
+				}
+				file.close();
+				complete = !file.fail();
+			}
+			// Closed first, so the partial file can also be removed where open files cannot.
+			std::error_code error;
+			if( complete )
+			{
+				std::filesystem::rename( temporary, path, error );
+			}
+			if( !complete || error )
+			{
+				std::filesystem::remove( temporary, error );
+				return false;
+			}
+			return true;
+		}
+
+	  private:
+		static uint64_t align( uint64_t offset )
+		{
+			return ( offset + section_alignment - 1 ) & ~uint64_t{ section_alignment - 1 };
+		}
+
+		std::vector<std::span<const std::byte>> sections_;
+	};
+
+	// A cache file mapped read-only. open() only succeeds for a well-formed file written for the same layout and
+	// the same input; anything else (missing, stale, truncated, another machine's) reads as no cache.
+	class Reader
+	{
+	  public:
+		static std::optional<Reader> open(
+		    const std::filesystem::path &path, uint32_t layout, uint64_t input_hash, uint64_t input_size )
+		{
+			std::error_code error;
+			if( !std::filesystem::exists( path, error ) )
+				return std::nullopt;
+			auto file = reader::FileView::map( path, { reader::ReadMode::Mapped } );
+			if( !file || file->size() < sizeof( Header ) )
+				return std::nullopt;
+
+			Header header;
+			std::memcpy( &header, file->data(), sizeof( header ) );
+			const Header current;
+			if( header.magic != current.magic || header.byte_order != current.byte_order ||
+			    header.format != format_version || header.layout != layout || header.input_hash != input_hash ||
+			    header.input_size != input_size )
+				return std::nullopt;
+			if( header.sections > ( file->size() - sizeof( Header ) ) / sizeof( Section ) )
+				return std::nullopt;
+
+			Reader cached;
+			cached.table_.resize( header.sections );
+			std::memcpy( cached.table_.data(), file->data() + sizeof( Header ), header.sections * sizeof( Section ) );
+			for( const Section &section : cached.table_ )
+			{
+				if( section.offset % section_alignment != 0 || section.offset > file->size() ||
+				    section.bytes > file->size() - section.offset )
+					return std::nullopt;
+			}
+			cached.file_ = std::move( *file );
+			return cached;
+		}
+
+		size_t sections() const { return table_.size(); }
+
+		// Section i viewed in place as Ts; nullopt if there is no such section or its size is not a whole number
+		// of Ts. Valid while the reader lives.
+		template <Flat T>
+		std::optional<std::span<const T>> section( size_t i ) const
+		{
+			if( i >= table_.size() || table_[i].bytes % sizeof( T ) != 0 )
+				return std::nullopt;
+			return std::span<const T>(
+			    reinterpret_cast<const T *>( file_.data() + table_[i].offset ), table_[i].bytes / sizeof( T ) );
+		}
+
+		// A section written with Writer::add_value.
+		template <Flat T>
+		std::optional<T> value( size_t i ) const
+		{
+			auto values = section<T>( i );
+			if( !values || values->size() != 1 )
+				return std::nullopt;
+			return values->front();
+		}
+
+	  private:
+		Reader() = default;
+
+		reader::FileView file_;
+		std::vector<Section> table_;
+	};
+
+} // namespace cache
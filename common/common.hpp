@@ -1,4 +1,13 @@
 #pragma once
 
+#include <arena.hpp> // IWYU pragma: export
 #include <args.hpp> // IWYU pragma: export
+#include <bench.hpp> // IWYU pragma: export
+#include <cache.hpp> // IWYU pragma: export
+#include <integer.hpp> // IWYU pragma: export
+#include <memory.hpp> // IWYU pragma: export
+#include <profiler.hpp> // IWYU pragma: export
 #include <reader.hpp> // IWYU pragma: export
+#include <solver.hpp> // IWYU pragma: export
+#include <thread_pool.hpp> // IWYU pragma: export
+#include <tokenizer.hpp> // IWYU pragma: export
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <span>
+#include <string_view>
+
+#include <tokenizer.hpp>
+
+namespace integer
+{
+
+	enum class ParseError
+	{
+		Empty,
+		InvalidDigit,
+		Overflow,
+		BufferTooSmall,
+	};
+
+	namespace detail
+	{
+		// True when all eight bytes of a little-endian word are ASCII digits.
+		inline bool all_digits( uint64_t chunk )
+		{
+			const uint64_t high = chunk & 0xF0F0F0F0F0F0F0F0;
+			const uint64_t carried = ( ( chunk + 0x0606060606060606 ) & 0xF0F0F0F0F0F0F0F0 ) >> 4;
+			return ( high | carried ) == 0x3333333333333333;
+		}
+
+		// Converts eight ASCII digits, first digit in the lowest byte, with three multiplies.
+		inline uint64_t eight_digits( uint64_t chunk )
+		{
+			constexpr uint64_t mask = 0x000000FF000000FF;
+			constexpr uint64_t mul1 = 100 + ( 1000000ull << 32 );
+			constexpr uint64_t mul2 = 1 + ( 10000ull << 32 );
+			chunk -= 0x3030303030303030;
+			chunk = ( chunk * 10 ) + ( chunk >> 8 );
+			return ( ( ( chunk & mask ) * mul1 ) + ( ( ( chunk >> 16 ) & mask ) * mul2 ) ) >> 32;
+		}
+
+		inline std::expected<uint64_t, ParseError> magnitude( const char *p, size_t n )
+		{
+			if( n == 0 )
+			{
+				return std::unexpected( ParseError::Empty );
+			}
+
+			// 19 decimal digits always fit in a uint64_t, so only the digits past that need overflow checks.
+			const size_t unchecked = std::min<size_t>( n, 19 );
+			uint64_t value = 0;
+			size_t i = 0;
+			if constexpr( std::endian::native == std::endian::little )
+			{
+				for( ; i + 8 <= unchecked; i += 8 )
+				{
+					uint64_t chunk;
+					std::memcpy( &chunk, p + i, sizeof( chunk ) );
+					if( !all_digits( chunk ) )
+					{
+						return std::unexpected( ParseError::InvalidDigit );
+					}
+					value = value * 100000000 + eight_digits( chunk );
+				}
+			}
+			for( ; i < unchecked; ++i )
+			{
+				const uint64_t digit = static_cast<unsigned char>( p[i] - '0' );
+				if( digit > 9 )
+				{
+					return std::unexpected( ParseError::InvalidDigit );
+				}
+				value = value * 10 + digit;
+			}
+			for( ; i < n; ++i )
+			{
+				const uint64_t digit = static_cast<unsigned char>( p[i] - '0' );
+				if( digit > 9 )
+				{
+					return std::unexpected( ParseError::InvalidDigit );
+				}
+				if( value > ( std::numeric_limits<uint64_t>::max() - digit ) / 10 )
+				{
+					return std::unexpected( ParseError::Overflow );
+				}
+				value = value * 10 + digit;
+			}
+			return value;
+		}
+	}
+
+	// Parses the whole span as a decimal integer, with an optional leading '-' or '+' for signed types.
+	template <std::integral T = uint64_t> inline std::expected<T, ParseError> parse( std::string_view text )
+	{
+		if constexpr( std::is_signed_v<T> )
+		{
+			const bool negative = !text.empty() && text.front() == '-';
+			if( !text.empty() && ( text.front() == '-' || text.front() == '+' ) )
+			{
+				text.remove_prefix( 1 );
+			}
+			auto value = detail::magnitude( text.data(), text.size() );
+			if( !value )
+			{
+				return std::unexpected( value.error() );
+			}
+			using U = std::make_unsigned_t<T>;
+			const uint64_t limit = static_cast<U>( std::numeric_limits<T>::max() ) + ( negative ? 1u : 0u );
+			if( *value > limit )
+			{
+				return std::unexpected( ParseError::Overflow );
+			}
+			return static_cast<T>( negative ? U( 0 ) - static_cast<U>( *value ) : static_cast<U>( *value ) );
+		}
+		else
+		{
+			auto value = detail::magnitude( text.data(), text.size() );
+			if( !value )
+			{
+				return std::unexpected( value.error() );
+			}
+			if( *value > std::numeric_limits<T>::max() )
+			{
+				return std::unexpected( ParseError::Overflow );
+			}
+			return static_cast<T>( *value );
+		}
+	}
+
+	// Number of records tokenizer::fields/lines would yield for this text.
+	inline size_t count_records( std::string_view text, char delimiter )
+	{
+		size_t count = 0;
+		for( size_t i = 0; i < text.size(); i += 64 )
+		{
+			const size_t n = std::min<size_t>( text.size() - i, 64 );
+			count += std::popcount( tokenizer::match_mask( text.data() + i, n, delimiter ) );
+		}
+		if( !text.empty() && text.back() != delimiter )
+		{
+			++count;
+		}
+		return count;
+	}
+
+	// Parses every record into out, returning how many were written.
+	template <std::integral T>
+	inline std::expected<size_t, ParseError> parse_records( const tokenizer::Splitter &records, std::span<T> out )
+	{
+		size_t count = 0;
+		for( std::string_view record : records )
+		{
+			if( count == out.size() )
+			{
+				return std::unexpected( ParseError::BufferTooSmall );
+			}
+			auto value = parse<T>( record );
+			if( !value )
+			{
+				return std::unexpected( value.error() );
+			}
+			out[count++] = *value;
+		}
+		return count;
+	}
+
+	// Parses a delimited column of numbers into a preallocated buffer. A '\n' delimiter also accepts "\r\n".
+	template <std::integral T>
+	inline std::expected<size_t, ParseError> parse_column( std::string_view text, char delimiter, std::span<T> out )
+	{
+		return parse_records( tokenizer::Splitter( text, delimiter, false, delimiter == '\n' ), out );
+	}
+
+} // namespace integer
@@ -0,0 +1,180 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include <memory.hpp>
+
+// Replacements for the global operator new and delete, so memory::Counters sees every heap allocation in the
+// process. Blocks come from malloc (or its aligned variant), and the allocator's own size of each block is
+// counted, so an allocation and its free always agree without storing the size alongside.
+
+namespace
+{
+
+	std::atomic<bool> counting{ false };
+	std::atomic<uint64_t> allocations{ 0 };
+	std::atomic<uint64_t> frees{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+	std::atomic<int64_t> live{ 0 };
+	std::atomic<int64_t> peak{ 0 };
+
+	bool over_aligned( size_t alignment ) { return alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__; }
+
+	size_t block_size( void *p, size_t alignment )
+	{
+#ifdef _WIN32
+		return over_aligned( alignment ) ? _aligned_msize( p, alignment, 0 ) : _msize( p );
+#elif defined( __APPLE__ )
+		(void)alignment;
+		return malloc_size( p );
+#else
+		(void)alignment;
+		return malloc_usable_size( p );
+#endif
+	}
+
+	void *try_allocate( size_t size, size_t alignment )
+	{
+		size = size == 0 ? 1 : size;
+		if( !over_aligned( alignment ) )
+			return std::malloc( size );
+#ifdef _WIN32
+		return _aligned_malloc( size, alignment );
+#else
+		// aligned_alloc wants a multiple of the alignment.
+		return std::aligned_alloc( alignment, ( size + alignment - 1 ) & ~( alignment - 1 ) );
+#endif
+	}
+
+	void record_allocation( void *p, size_t alignment )
+	{
+		if( !p || !counting.load( std::memory_order_relaxed ) )
+			return;
+		const auto size = static_cast<int64_t>( block_size( p, alignment ) );
+		allocations.fetch_add( 1, std::memory_order_relaxed );
+		bytes.fetch_add( static_cast<uint64_t>( size ), std::memory_order_relaxed );
+		const int64_t now = live.fetch_add( size, std::memory_order_relaxed ) + size;
+		int64_t highest = peak.load( std::memory_order_relaxed );
+		while( now > highest && !peak.compare_exchange_weak( highest, now, std::memory_order_relaxed ) )
+		{
+		}
+	}
+
+	// Follows the standard operator new: retry through the new handler, throw once there is none.
+	void *allocate( size_t size, size_t alignment )
+	{
+		void *p;
+		while( !( p = try_allocate( size, alignment ) ) )
+		{
+			std::new_handler handler = std::get_new_handler();
+			if( !handler )
+				throw std::bad_alloc();
+			handler();
+		}
+		record_allocation( p, alignment );
+		return p;
+	}
+
+	void *allocate( size_t size, size_t alignment, const std::nothrow_t & ) noexcept
+	{
+		try
+		{
+			return allocate( size, alignment );
+		}
+		catch( ... )
+		{
+			return nullptr;
+		}
+	}
+
+	void deallocate( void *p, size_t alignment ) noexcept
+	{
+		if( !p )
+			return;
+		if( counting.load( std::memory_order_relaxed ) )
+		{
+			frees.fetch_add( 1, std::memory_order_relaxed );
+			live.fetch_sub( static_cast<int64_t>( block_size( p, alignment ) ), std::memory_order_relaxed );
+		}
+#ifdef _WIN32
+		if( over_aligned( alignment ) )
+		{
+			_aligned_free( p );
+			return;
+		}
+#endif
+		std::free( p );
+	}
+
+	constexpr size_t default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+} // namespace
+
+namespace memory
+{
+
+	void enable() { counting.store( true, std::memory_order_relaxed ); }
+
+	bool enabled() { return counting.load( std::memory_order_relaxed ); }
+
+	Counters counters()
+	{
+		return { allocations.load( std::memory_order_relaxed ), frees.load( std::memory_order_relaxed ),
+		         bytes.load( std::memory_order_relaxed ), live.load( std::memory_order_relaxed ),
+		         peak.load( std::memory_order_relaxed ) };
+	}
+
+	void reset_peak() { peak.store( live.load( std::memory_order_relaxed ), std::memory_order_relaxed ); }
+
+} // namespace memory
+
+void *operator new( size_t size ) { return allocate( size, default_alignment ); }
+void *operator new[]( size_t size ) { return allocate( size, default_alignment ); }
+void *operator new( size_t size, const std::nothrow_t &tag ) noexcept
+{
+	return allocate( size, default_alignment, tag );
+}
+void *operator new[]( size_t size, const std::nothrow_t &tag ) noexcept
+{
+	return allocate( size, default_alignment, tag );
+}
+void *operator new( size_t size, std::align_val_t alignment ) { return allocate( size, size_t( alignment ) ); }
+void *operator new[]( size_t size, std::align_val_t alignment ) { return allocate( size, size_t( alignment ) ); }
+void *operator new( size_t size, std::align_val_t alignment, const std::nothrow_t &tag ) noexcept
+{
+	return allocate( size, size_t( alignment ), tag );
+}
+void *operator new[]( size_t size, std::align_val_t alignment, const std::nothrow_t &tag ) noexcept
+{
+	return allocate( size, size_t( alignment ), tag );
+}
+
+void operator delete( void *p ) noexcept { deallocate( p, default_alignment ); }
+void operator delete[]( void *p ) noexcept { deallocate( p, default_alignment ); }
+void operator delete( void *p, size_t ) noexcept { deallocate( p, default_alignment ); }
+void operator delete[]( void *p, size_t ) noexcept { deallocate( p, default_alignment ); }
+void operator delete( void *p, const std::nothrow_t & ) noexcept { deallocate( p, default_alignment ); }
+void operator delete[]( void *p, const std::nothrow_t & ) noexcept { deallocate( p, default_alignment ); }
+void operator delete( void *p, std::align_val_t alignment ) noexcept { deallocate( p, size_t( alignment ) ); }
+void operator delete[]( void *p, std::align_val_t alignment ) noexcept { deallocate( p, size_t( alignment ) ); }
+void operator delete( void *p, size_t, std::align_val_t alignment ) noexcept { deallocate( p, size_t( alignment ) ); }
+void operator delete[]( void *p, size_t, std::align_val_t alignment ) noexcept
+{
+	deallocate( p, size_t( alignment ) );
+}
+void operator delete( void *p, std::align_val_t alignment, const std::nothrow_t & ) noexcept
+{
+	deallocate( p, size_t( alignment ) );
+}
+void operator delete[]( void *p, std::align_val_t alignment, const std::nothrow_t & ) noexcept
+{
+	deallocate( p, size_t( alignment ) );
+}
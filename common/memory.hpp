@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <args.hpp>
+
+namespace memory
+{
+
+	// Process-wide heap totals, kept by the global operator new and delete that memory.cpp replaces. Counting is
+	// off until enable() is called, and costs a single relaxed load per allocation while it is off.
+	struct Counters
+	{
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t bytes = 0;
+		// Bytes allocated and not yet freed, and the most there have been since reset_peak(). Blocks allocated
+		// before counting started are not known, so freeing them can take live below zero.
+		int64_t live = 0;
+		int64_t peak = 0;
+	};
+
+	void enable();
+	bool enabled();
+	Counters counters();
+	// Starts a new peak from the bytes live right now.
+	void reset_peak();
+
+	// Peak resident set size (VmHWM) of the process in KiB, or nullopt where /proc/self/status does not exist.
+	inline std::optional<uint64_t> peak_rss_kib()
+	{
+		std::ifstream status( "/proc/self/status" );
+		std::string line;
+		while( std::getline( status, line ) )
+		{
+			if( !line.starts_with( "VmHWM:" ) )
+				continue;
+			const size_t digits = line.find_first_of( "0123456789" );
+			if( digits == std::string::npos )
+				return std::nullopt;
+			return std::stoull( line.substr( digits ) );
+		}
+		return std::nullopt;
+	}
+
+	struct Phase
+	{
+		std::string name;
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+		// Most bytes live at once during the phase, above what was live when it started.
+		int64_t peak = 0;
+		// Bytes the phase left allocated, e.g. a parse result.
+		int64_t retained = 0;
+	};
+
+	// Records heap use per phase when --memory is given, alongside --bench and --profile. Counters are process
+	// wide, so phases of days solved concurrently by the aoc runner include each other's allocations.
+	class Tracker
+	{
+	  public:
+		class Scope
+		{
+		  public:
+			Scope( Tracker *tracker, std::string_view phase )
+			    : tracker_( tracker )
+			    , phase_( phase )
+			{
+				if( tracker_ )
+				{
+					reset_peak();
+					start_ = counters();
+				}
+			}
+
+			Scope( const Scope & ) = delete;
+			Scope &operator=( const Scope & ) = delete;
+
+			~Scope()
+			{
+				if( !tracker_ )
+					return;
+				const Counters end = counters();
+				tracker_->phases_.push_back( { std::string( phase_ ), end.allocations - start_.allocations,
+				                               end.bytes - start_.bytes, end.peak - start_.live,
+				                               end.live - start_.live } );
+			}
+
+		  private:
+			Tracker *tracker_;
+			std::string_view phase_;
+			Counters start_;
+		};
+
+		Tracker() = default;
+
+		explicit Tracker( const args::Parser &parser, std::string_view name = {} )
+		    : name_( name )
+		    , enabled_( parser.has( "memory" ) )
+		{
+			if( enabled_ )
+			{
+				enable();
+			}
+		}
+
+		bool enabled() const { return enabled_; }
+
+		// The phase name must outlive the scope; string literals are the intended use.
+		Scope scope( std::string_view phase ) { return Scope( enabled_ ? this : nullptr, phase ); }
+
+		const std::vector<Phase> &phases() const { return phases_; }
+
+		void report() const
+		{
+			if( !enabled_ )
+				return;
+
+			std::println( "" );
+			std::println( "Memory{}{}:", name_.empty() ? "" : " ", name_ );
+			std::println( "{:<16} {:>12} {:>14} {:>14} {:>14}", "phase", "allocations", "bytes", "peak bytes",
+			              "retained" );
+			for( const Phase &phase : phases_ )
+			{
+				std::println( "{:<16} {:>12} {:>14} {:>14} {:>14}", phase.name, phase.allocations, phase.bytes,
+				              phase.peak, phase.retained );
+			}
+			if( auto rss = peak_rss_kib() )
+			{
+				std::println( "peak RSS {} KiB", *rss );
+			}
+		}
+
+	  private:
+		std::string name_;
+		bool enabled_ = false;
+		std::vector<Phase> phases_;
+	};
+
+} // namespace memory
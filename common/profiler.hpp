@@ -0,0 +1,278 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <args.hpp>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace profile
+{
+
+	enum class Counter
+	{
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+	};
+
+	inline constexpr size_t counter_count = 4;
+	inline constexpr std::array<std::string_view, counter_count> counter_names = {
+		"cycles",
+		"instructions",
+		"cache_misses",
+		"branch_misses",
+	};
+
+	// A reading of every counter; nullopt where the counter could not be opened.
+	using Counts = std::array<std::optional<uint64_t>, counter_count>;
+
+	// Hardware counters of the calling thread, user space only, opened as one perf_event group so they are read
+	// together. Counters the kernel refuses (no PMU in a VM, perf_event_paranoid too strict) are left out, and
+	// without any of them every reading is empty. Other platforms get no counters at all.
+	class CounterGroup
+	{
+	  public:
+		CounterGroup()
+		{
+#ifdef __linux__
+			constexpr std::array<uint64_t, counter_count> configs = {
+				PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_CACHE_MISSES,
+				PERF_COUNT_HW_BRANCH_MISSES,
+			};
+			for( size_t i = 0; i < counter_count; ++i )
+			{
+				perf_event_attr attr{};
+				attr.size = sizeof( attr );
+				attr.type = PERF_TYPE_HARDWARE;
+				attr.config = configs[i];
+				attr.disabled = leader_ < 0;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP;
+				const int fd = static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, leader_, 0 ) );
+				if( fd < 0 )
+					continue;
+				if( leader_ < 0 )
+				{
+					leader_ = fd;
+				}
+				fds_.push_back( fd );
+				opened_.push_back( i );
+			}
+			if( leader_ >= 0 )
+			{
+				ioctl( leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+				ioctl( leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+			}
+#endif
+		}
+
+		CounterGroup( const CounterGroup & ) = delete;
+		CounterGroup &operator=( const CounterGroup & ) = delete;
+
+		~CounterGroup()
+		{
+#ifdef __linux__
+			for( int fd : fds_ )
+			{
+				close( fd );
+			}
+#endif
+		}
+
+		bool available() const { return !opened_.empty(); }
+
+		// Running totals since the group was opened; phases take the difference of two readings.
+		Counts read() const
+		{
+			Counts counts;
+#ifdef __linux__
+			if( leader_ < 0 )
+				return counts;
+			// PERF_FORMAT_GROUP layout: the number of counters, then one value per counter in opening order.
+			std::array<uint64_t, 1 + counter_count> buffer{};
+			if( ::read( leader_, buffer.data(), sizeof( buffer ) ) <= 0 )
+				return counts;
+			for( size_t i = 0; i < opened_.size() && i < buffer[0]; ++i )
+			{
+				counts[opened_[i]] = buffer[1 + i];
+			}
+#endif
+			return counts;
+		}
+
+	  private:
+		int leader_ = -1;
+		std::vector<int> fds_;
+		std::vector<size_t> opened_;
+	};
+
+	struct Phase
+	{
+		std::string name;
+		double nanoseconds = 0;
+		Counts counts;
+	};
+
+	// Records wall time and hardware counters per phase when --profile <report.json> is given, and writes the
+	// report there when destroyed. Disabled, a scope is a null pointer and costs nothing but the check.
+	// Profilers sharing a command line are told apart by a name: "day3" writes report.day3.json.
+	//
+	//     profile::Profiler profiler( parser );
+	//     {
+	//         auto scope = profiler.scope( "parse" );
+	//         ...
+	//     }
+	class Profiler
+	{
+	  public:
+		class Scope
+		{
+		  public:
+			Scope( Profiler *profiler, std::string_view phase )
+			    : profiler_( profiler )
+			    , phase_( phase )
+			{
+				if( profiler_ )
+				{
+					counts_ = profiler_->counters_->read();
+					start_ = std::chrono::steady_clock::now();
+				}
+			}
+
+			Scope( const Scope & ) = delete;
+			Scope &operator=( const Scope & ) = delete;
+
+			~Scope()
+			{
+				if( !profiler_ )
+					return;
+				const auto end = std::chrono::steady_clock::now();
+				const Counts counts = profiler_->counters_->read();
+				Phase phase{ std::string( phase_ ), std::chrono::duration<double, std::nano>( end - start_ ).count() };
+				for( size_t i = 0; i < counter_count; ++i )
+				{
+					if( counts[i] && counts_[i] )
+					{
+						phase.counts[i] = *counts[i] - *counts_[i];
+					}
+				}
+				profiler_->phases_.push_back( std::move( phase ) );
+			}
+
+		  private:
+			Profiler *profiler_;
+			std::string_view phase_;
+			Counts counts_;
+			std::chrono::steady_clock::time_point start_;
+		};
+
+		Profiler() = default;
+
+		explicit Profiler( const args::Parser &parser, std::string_view name = {} )
+		    : path_( parser.get( "profile" ) )
+		{
+			if( !path_ )
+				return;
+			if( !name.empty() )
+			{
+				std::filesystem::path path( *path_ );
+				path.replace_extension( std::format( ".{}{}", name, path.extension().string() ) );
+				path_ = path.string();
+			}
+			counters_ = std::make_unique<CounterGroup>();
+		}
+
+		Profiler( const Profiler & ) = delete;
+		Profiler &operator=( const Profiler & ) = delete;
+
+		~Profiler()
+		{
+			if( !path_ )
+				return;
+			std::ofstream file( *path_, std::ios::out | std::ios::binary );
+			if( !file )
+			{
+				std::println( stderr, "cannot write profile to {}", *path_ );
+				return;
+			}
+			file << json();
+		}
+
+		bool enabled() const { return path_.has_value(); }
+
+		// The phase name must outlive the scope; string literals are the intended use.
+		Scope scope( std::string_view phase ) { return Scope( enabled() ? this : nullptr, phase ); }
+
+		const std::vector<Phase> &phases() const { return phases_; }
+
+		std::string json() const
+		{
+			std::string out = "{\n";
+			out += std::format( "  \"counters\": {},\n", counters_ && counters_->available() );
+			out += "  \"phases\": [";
+			for( size_t p = 0; p < phases_.size(); ++p )
+			{
+				const Phase &phase = phases_[p];
+				out += p == 0 ? "\n" : ",\n";
+				out += std::format( "    {{ \"name\": \"{}\", \"wall_ns\": {:.0f}", escape( phase.name ),
+				                    phase.nanoseconds );
+				for( size_t i = 0; i < counter_count; ++i )
+				{
+					out += std::format( ", \"{}\": ", counter_names[i] );
+					out += phase.counts[i] ? std::to_string( *phase.counts[i] ) : "null";
+				}
+				const auto &cycles = phase.counts[static_cast<size_t>( Counter::Cycles )];
+				const auto &instructions = phase.counts[static_cast<size_t>( Counter::Instructions )];
+				if( cycles && instructions && *cycles > 0 )
+				{
+					out += std::format( ", \"ipc\": {:.3f}", static_cast<double>( *instructions ) / *cycles );
+				}
+				out += " }";
+			}
+			out += phases_.empty() ? "]\n}\n" : "\n  ]\n}\n";
+			return out;
+		}
+
+	  private:
+		static std::string escape( std::string_view text )
+		{
+			std::string out;
+			for( char c : text )
+			{
+				if( c == '"' || c == '\\' )
+				{
+					out += '\\';
+				}
+				out += c;
+			}
+			return out;
+		}
+
+		std::optional<std::string> path_;
+		std::unique_ptr<CounterGroup> counters_;
+		std::vector<Phase> phases_;
+	};
+
+} // namespace profile
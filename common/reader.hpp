@@ -1,12 +1,46 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <expected>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include <args.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined( __linux__ ) && __has_include( <linux/io_uring.h> )
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined( SYS_io_uring_setup ) && defined( SYS_io_uring_enter )
+#define AOC_IO_URING 1
+#endif
+#endif
+
 namespace reader
 {
 
@@ -17,6 +51,92 @@ namespace reader
 		ReadFailed,
 	};
 
+	enum class ReadMode
+	{
+		Buffered,
+		Mapped,
+		// Parsers that can take their input a chunk at a time get it from read_chunks; the rest read it buffered.
+		Streamed,
+	};
+
+	struct ReadOptions
+	{
+		ReadMode mode = ReadMode::Buffered;
+		// Ask the kernel to back the mapping with transparent huge pages (mapped mode only).
+		bool huge_pages = false;
+		// Bytes per read in streamed mode.
+		size_t chunk_size = 1 << 20;
+		// Streamed reads go through io_uring where the kernel offers it, or a pread thread otherwise.
+		bool io_uring = true;
+	};
+
+	// Read-only file contents, either memory-mapped or owned in a buffer.
+	// Converts to std::string_view so it can be handed to any parser taking one.
+	class FileView
+	{
+	  public:
+		FileView() = default;
+
+		explicit FileView( std::string buffer )
+		    : buffer_( std::move( buffer ) )
+		    , data_( buffer_.data() )
+		    , size_( buffer_.size() )
+		{
+		}
+
+		FileView( const FileView & ) = delete;
+		FileView &operator=( const FileView & ) = delete;
+
+		FileView( FileView &&other ) noexcept { *this = std::move( other ); }
+
+		FileView &operator=( FileView &&other ) noexcept
+		{
+			if( this != &other )
+			{
+				unmap();
+				mapping_ = std::exchange( other.mapping_, nullptr );
+				buffer_ = std::move( other.buffer_ );
+				data_ = mapping_ ? std::exchange( other.data_, nullptr ) : buffer_.data();
+				size_ = std::exchange( other.size_, 0 );
+				other.data_ = nullptr;
+			}
+			return *this;
+		}
+
+		~FileView() { unmap(); }
+
+		const char *data() const { return data_; }
+		size_t size() const { return size_; }
+		bool empty() const { return size_ == 0; }
+		bool mapped() const { return mapping_ != nullptr; }
+
+		const char *begin() const { return data_; }
+		const char *end() const { return data_ + size_; }
+
+		std::string_view view() const { return { data_, size_ }; }
+		operator std::string_view() const { return view(); }
+
+		static std::expected<FileView, ReadError> map( const std::filesystem::path &path, const ReadOptions &options );
+
+	  private:
+		void unmap()
+		{
+			if( !mapping_ )
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile( mapping_ );
+#else
+			munmap( mapping_, size_ );
+#endif
+			mapping_ = nullptr;
+		}
+
+		std::string buffer_;
+		const char *data_ = nullptr;
+		size_t size_ = 0;
+		void *mapping_ = nullptr;
+	};
+
 	template <typename T>
 	    requires std::same_as<T, std::string> || std::same_as<T, std::vector<uint8_t>>
 	inline std::expected<T, ReadError> read_file( const std::filesystem::path &path )
@@ -61,4 +181,521 @@ namespace reader
 		return content;
 	}
 
+	inline std::expected<FileView, ReadError> FileView::map(
+	    const std::filesystem::path &path,
+	    const ReadOptions &options )
+	{
+		if( !std::filesystem::exists( path ) )
+		{
+			return std::unexpected( ReadError::FileNotFound );
+		}
+
+		FileView view;
+#ifdef _WIN32
+		HANDLE file = CreateFileW(
+		    path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if( file == INVALID_HANDLE_VALUE )
+		{
+			return std::unexpected( ReadError::CannotOpen );
+		}
+
+		LARGE_INTEGER size;
+		if( !GetFileSizeEx( file, &size ) )
+		{
+			CloseHandle( file );
+			return std::unexpected( ReadError::ReadFailed );
+		}
+		if( size.QuadPart == 0 )
+		{
+			CloseHandle( file );
+			return view;
+		}
+
+		// The view keeps the mapping object and the file alive, so both handles can be closed right away.
+		HANDLE mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		CloseHandle( file );
+		if( !mapping )
+		{
+			return std::unexpected( ReadError::ReadFailed );
+		}
+		void *address = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		CloseHandle( mapping );
+		if( !address )
+		{
+			return std::unexpected( ReadError::ReadFailed );
+		}
+		view.size_ = static_cast<size_t>( size.QuadPart );
+#else
+		int fd = ::open( path.c_str(), O_RDONLY );
+		if( fd < 0 )
+		{
+			return std::unexpected( ReadError::CannotOpen );
+		}
+
+		struct stat info;
+		if( ::fstat( fd, &info ) != 0 )
+		{
+			::close( fd );
+			return std::unexpected( ReadError::ReadFailed );
+		}
+		if( info.st_size == 0 )
+		{
+			::close( fd );
+			return view;
+		}
+
+		// No MAP_POPULATE: it would fault in every page as a small page before mmap returns, ahead of the advice
+		// below. Readahead then overlaps the parse instead of blocking here.
+		void *address = ::mmap( nullptr, static_cast<size_t>( info.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+		::close( fd );
+		if( address == MAP_FAILED )
+		{
+			return std::unexpected( ReadError::ReadFailed );
+		}
+		view.size_ = static_cast<size_t>( info.st_size );
+
+		// Advice is best effort: a kernel that ignores it still gives a valid mapping. It is given before the first
+		// access, so the pages are faulted in with it.
+#ifdef MADV_HUGEPAGE
+		if( options.huge_pages )
+		{
+			::madvise( address, view.size_, MADV_HUGEPAGE );
+		}
+#endif
+		::madvise( address, view.size_, MADV_SEQUENTIAL );
+		::madvise( address, view.size_, MADV_WILLNEED );
+#endif
+		(void)options;
+		view.mapping_ = address;
+		view.data_ = static_cast<const char *>( address );
+		return view;
+	}
+
+	template <typename T>
+	    requires std::same_as<T, FileView>
+	inline std::expected<T, ReadError> read_file( const std::filesystem::path &path, const ReadOptions &options = {} )
+	{
+		if( options.mode == ReadMode::Mapped )
+		{
+			return FileView::map( path, options );
+		}
+		auto content = read_file<std::string>( path );
+		if( !content )
+		{
+			return std::unexpected( content.error() );
+		}
+		return FileView( std::move( *content ) );
+	}
+
+#ifndef _WIN32
+	namespace detail
+	{
+		// Reads kept in flight for read_chunks, one per buffer slot.
+		class ReadQueue
+		{
+		  public:
+			virtual ~ReadQueue() = default;
+
+			virtual void submit( size_t slot, char *buffer, size_t size, uint64_t offset ) = 0;
+			// Bytes read into the slot's buffer, or a negative errno if the read failed and can be redone. ReadFailed
+			// when the queue itself broke and the read may still be landing in the buffer.
+			virtual std::expected<int64_t, ReadError> wait( size_t slot ) = 0;
+		};
+
+		// Reads on a background thread with pread, the fallback wherever io_uring is missing or refused.
+		class PreadQueue : public ReadQueue
+		{
+		  public:
+			explicit PreadQueue( int fd )
+			    : fd_( fd )
+			    , worker_( [this]( std::stop_token stop ) { work( stop ); } )
+			{
+			}
+
+			void submit( size_t slot, char *buffer, size_t size, uint64_t offset ) override
+			{
+				{
+					std::lock_guard lock( mutex_ );
+					requests_[slot] = { buffer, size, offset, true };
+				}
+				submitted_.notify_one();
+			}
+
+			std::expected<int64_t, ReadError> wait( size_t slot ) override
+			{
+				std::unique_lock lock( mutex_ );
+				completed_.wait( lock, [&] { return requests_[slot].result.has_value(); } );
+				return *std::exchange( requests_[slot].result, std::nullopt );
+			}
+
+		  private:
+			struct Request
+			{
+				char *buffer = nullptr;
+				size_t size = 0;
+				uint64_t offset = 0;
+				bool pending = false;
+				std::optional<int64_t> result;
+			};
+
+			// Serves the earliest pending read first. Pending reads are finished even after a stop request, so
+			// no buffer is written once the queue is gone.
+			void work( std::stop_token stop )
+			{
+				std::unique_lock lock( mutex_ );
+				while( true )
+				{
+					auto pending = [&] { return std::ranges::any_of( requests_, &Request::pending ); };
+					submitted_.wait( lock, stop, pending );
+					if( !pending() )
+						return;
+					Request &request = *std::ranges::min_element( requests_, {}, []( const Request &r ) {
+						return r.pending ? r.offset : UINT64_MAX;
+					} );
+					request.pending = false;
+					lock.unlock();
+					ssize_t read = ::pread( fd_, request.buffer, request.size, static_cast<off_t>( request.offset ) );
+					int64_t result = read < 0 ? -errno : read;
+					lock.lock();
+					request.result = result;
+					completed_.notify_all();
+				}
+			}
+
+			int fd_;
+			std::mutex mutex_;
+			std::condition_variable_any submitted_;
+			std::condition_variable completed_;
+			std::array<Request, 2> requests_;
+			// Declared last so the thread is joined before the requests it serves are destroyed.
+			std::jthread worker_;
+		};
+
+#ifdef AOC_IO_URING
+		// A minimal io_uring driven through the raw syscalls: one submission per read, completions matched back to
+		// their slot by user_data. create() returns null when the kernel has no io_uring or a sandbox refuses it.
+		class UringQueue : public ReadQueue
+		{
+		  public:
+			static std::unique_ptr<UringQueue> create( int fd )
+			{
+				io_uring_params params{};
+				const int ring = static_cast<int>( syscall( SYS_io_uring_setup, 4, &params ) );
+				if( ring < 0 )
+					return nullptr;
+				std::unique_ptr<UringQueue> queue( new UringQueue( fd, ring ) );
+				return queue->map( params ) ? std::move( queue ) : nullptr;
+			}
+
+			UringQueue( const UringQueue & ) = delete;
+			UringQueue &operator=( const UringQueue & ) = delete;
+
+			~UringQueue() override
+			{
+				// The kernel may still be writing into buffers the caller is about to free.
+				while( in_flight_ > 0 && reap() )
+				{
+				}
+				for( auto [address, size] : mappings_ )
+				{
+					::munmap( address, size );
+				}
+				::close( ring_ );
+			}
+
+			void submit( size_t slot, char *buffer, size_t size, uint64_t offset ) override
+			{
+				const unsigned tail = *sq_tail_;
+				const unsigned index = tail & *sq_mask_;
+				io_uring_sqe &sqe = sqes_[index];
+				std::memset( &sqe, 0, sizeof( sqe ) );
+				sqe.opcode = IORING_OP_READ;
+				sqe.fd = fd_;
+				sqe.addr = reinterpret_cast<uint64_t>( buffer );
+				sqe.len = static_cast<uint32_t>( size );
+				sqe.off = offset;
+				sqe.user_data = slot;
+				sq_array_[index] = index;
+				__atomic_store_n( sq_tail_, tail + 1, __ATOMIC_RELEASE );
+				results_[slot].reset();
+				if( enter( 1, 0 ) != 1 )
+				{
+					// Never reached the kernel: take the entry back off the ring, so a later enter does not submit
+					// it, and report a failed read, which read_chunks redoes with pread.
+					__atomic_store_n( sq_tail_, tail, __ATOMIC_RELEASE );
+					results_[slot] = -EIO;
+					return;
+				}
+				++in_flight_;
+			}
+
+			std::expected<int64_t, ReadError> wait( size_t slot ) override
+			{
+				while( !results_[slot] )
+				{
+					// The read may still be in flight, so its buffer cannot be handed to pread.
+					if( !reap() )
+						return std::unexpected( ReadError::ReadFailed );
+				}
+				return *std::exchange( results_[slot], std::nullopt );
+			}
+
+		  private:
+			UringQueue( int fd, int ring )
+			    : fd_( fd )
+			    , ring_( ring )
+			{
+			}
+
+			bool map( const io_uring_params &params )
+			{
+				auto mapping = [&]( size_t size, off_t offset ) -> char * {
+					void *address = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_,
+					                        offset );
+					if( address == MAP_FAILED )
+						return nullptr;
+					mappings_.push_back( { address, size } );
+					return static_cast<char *>( address );
+				};
+
+				size_t sq_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+				size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+				const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+				if( single )
+				{
+					sq_size = cq_size = std::max( sq_size, cq_size );
+				}
+				char *sq = mapping( sq_size, IORING_OFF_SQ_RING );
+				char *cq = single ? sq : mapping( cq_size, IORING_OFF_CQ_RING );
+				char *sqes = mapping( params.sq_entries * sizeof( io_uring_sqe ), IORING_OFF_SQES );
+				if( !sq || !cq || !sqes )
+					return false;
+
+				sq_tail_ = reinterpret_cast<unsigned *>( sq + params.sq_off.tail );
+				sq_mask_ = reinterpret_cast<unsigned *>( sq + params.sq_off.ring_mask );
+				sq_array_ = reinterpret_cast<unsigned *>( sq + params.sq_off.array );
+				sqes_ = reinterpret_cast<io_uring_sqe *>( sqes );
+				cq_head_ = reinterpret_cast<unsigned *>( cq + params.cq_off.head );
+				cq_tail_ = reinterpret_cast<unsigned *>( cq + params.cq_off.tail );
+				cq_mask_ = reinterpret_cast<unsigned *>( cq + params.cq_off.ring_mask );
+				cqes_ = reinterpret_cast<io_uring_cqe *>( cq + params.cq_off.cqes );
+				return true;
+			}
+
+			int enter( unsigned submit, unsigned wait )
+			{
+				while( true )
+				{
+					const long result = syscall( SYS_io_uring_enter, ring_, submit, wait,
+					                             wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0 );
+					if( result >= 0 || errno != EINTR )
+						return static_cast<int>( result );
+				}
+			}
+
+			// Takes one completion off the ring, blocking until there is one. False if the ring is broken.
+			bool reap()
+			{
+				unsigned head = *cq_head_;
+				while( head == __atomic_load_n( cq_tail_, __ATOMIC_ACQUIRE ) )
+				{
+					if( enter( 0, 1 ) < 0 )
+						return false;
+				}
+				const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+				results_[cqe.user_data] = cqe.res;
+				__atomic_store_n( cq_head_, head + 1, __ATOMIC_RELEASE );
+				--in_flight_;
+				return true;
+			}
+
+			int fd_;
+			int ring_;
+			std::vector<std::pair<void *, size_t>> mappings_;
+			unsigned *sq_tail_ = nullptr;
+			unsigned *sq_mask_ = nullptr;
+			unsigned *sq_array_ = nullptr;
+			io_uring_sqe *sqes_ = nullptr;
+			unsigned *cq_head_ = nullptr;
+			unsigned *cq_tail_ = nullptr;
+			unsigned *cq_mask_ = nullptr;
+			io_uring_cqe *cqes_ = nullptr;
+			std::array<std::optional<int64_t>, 2> results_;
+			size_t in_flight_ = 0;
+		};
+#endif
+
+		struct Descriptor
+		{
+			int fd;
+			~Descriptor()
+			{
+				if( fd >= 0 )
+					::close( fd );
+			}
+		};
+	}
+#endif
+
+	// Reads a file front to back and calls consume( std::string_view ) on consecutive chunks of it that end on a
+	// line boundary (only the last may not), so line parsers can run while the disk works: two buffers alternate,
+	// and the read of the next chunk is in flight while the current one is consumed. A partial line at the end of a
+	// chunk is carried to the front of the next; a line longer than a whole chunk is gathered separately. Chunks
+	// are only valid during the call. Reads use io_uring on Linux, or a pread thread where that is unavailable; on
+	// Windows the file is read whole and handed over as one chunk.
+	template <typename F>
+	std::expected<void, ReadError> read_chunks( const std::filesystem::path &path, F &&consume,
+	                                            const ReadOptions &options = {} )
+	{
+		if( !std::filesystem::exists( path ) )
+		{
+			return std::unexpected( ReadError::FileNotFound );
+		}
+#ifdef _WIN32
+		auto content = read_file<std::string>( path );
+		if( !content )
+		{
+			return std::unexpected( content.error() );
+		}
+		if( !content->empty() )
+		{
+			consume( std::string_view( *content ) );
+		}
+		return {};
+#else
+		const detail::Descriptor file{ ::open( path.c_str(), O_RDONLY ) };
+		if( file.fd < 0 )
+		{
+			return std::unexpected( ReadError::CannotOpen );
+		}
+		struct stat info;
+		if( ::fstat( file.fd, &info ) != 0 )
+		{
+			return std::unexpected( ReadError::ReadFailed );
+		}
+		const auto size = static_cast<uint64_t>( info.st_size );
+#ifdef POSIX_FADV_SEQUENTIAL
+		::posix_fadvise( file.fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+		// Each buffer keeps chunk bytes in front of its reads for the partial line carried in from the previous one.
+		const size_t chunk = std::clamp<size_t>( options.chunk_size, 4096, size_t{ 1 } << 30 );
+		const std::array<std::unique_ptr<char[]>, 2> buffers = {
+			std::make_unique_for_overwrite<char[]>( 2 * chunk ),
+			std::make_unique_for_overwrite<char[]>( 2 * chunk ),
+		};
+		// Declared after the buffers, so outstanding reads are drained before the buffers are freed.
+		std::unique_ptr<detail::ReadQueue> queue;
+#ifdef AOC_IO_URING
+		if( options.io_uring )
+		{
+			queue = detail::UringQueue::create( file.fd );
+		}
+#endif
+		if( !queue )
+		{
+			queue = std::make_unique<detail::PreadQueue>( file.fd );
+		}
+
+		auto length = [&]( uint64_t offset ) {
+			return static_cast<size_t>( std::min<uint64_t>( chunk, size - offset ) );
+		};
+		uint64_t next = 0;
+		auto submit = [&]( size_t slot ) {
+			if( next < size )
+			{
+				queue->submit( slot, buffers[slot].get() + chunk, length( next ), next );
+				next += length( next );
+			}
+		};
+		submit( 0 );
+		submit( 1 );
+
+		size_t carry = 0;
+		std::string spill;
+		for( uint64_t offset = 0, slot = 0; offset < size; slot ^= 1 )
+		{
+			const size_t expected = length( offset );
+			char *data = buffers[slot].get() + chunk;
+			// Short or failed asynchronous reads (signals, kernels without IORING_OP_READ) finish with pread.
+			const auto result = queue->wait( slot );
+			if( !result )
+				return std::unexpected( result.error() );
+			size_t done = static_cast<size_t>( std::max<int64_t>( *result, 0 ) );
+			while( done < expected )
+			{
+				ssize_t read = ::pread( file.fd, data + done, expected - done, static_cast<off_t>( offset + done ) );
+				if( read < 0 && errno == EINTR )
+					continue;
+				if( read <= 0 )
+					return std::unexpected( ReadError::ReadFailed );
+				done += static_cast<size_t>( read );
+			}
+			offset += expected;
+			const bool last = offset == size;
+
+			std::string_view view( data - carry, carry + expected );
+			carry = 0;
+			if( !spill.empty() )
+			{
+				const size_t newline = view.find( '\n' );
+				const size_t take = newline == std::string_view::npos ? view.size() : newline + 1;
+				spill.append( view.substr( 0, take ) );
+				view.remove_prefix( take );
+				if( newline != std::string_view::npos || last )
+				{
+					consume( std::string_view( spill ) );
+					spill.clear();
+				}
+			}
+			if( last )
+			{
+				if( !view.empty() )
+					consume( view );
+				break;
+			}
+			if( spill.empty() )
+			{
+				const size_t end = view.rfind( '\n' ) + 1; // 0 when there is no newline
+				if( end > 0 )
+				{
+					consume( view.substr( 0, end ) );
+				}
+				const std::string_view tail = view.substr( end );
+				if( tail.size() <= chunk )
+				{
+					std::memcpy( buffers[slot ^ 1].get() + chunk - tail.size(), tail.data(), tail.size() );
+					carry = tail.size();
+				}
+				else
+				{
+					spill.assign( tail );
+				}
+			}
+			submit( slot );
+		}
+		return {};
+#endif
+	}
+
+	// --read <buffered|mmap|stream> selects the backend, --huge-pages requests huge page backing for mappings,
+	// --chunk-size <bytes> sizes streamed reads and --no-io-uring streams through the pread thread.
+	inline ReadOptions read_options( const args::Parser &parser )
+	{
+		ReadOptions options;
+		const std::string mode = parser.get_or( "read", "buffered" );
+		if( mode == "mmap" )
+		{
+			options.mode = ReadMode::Mapped;
+		}
+		else if( mode == "stream" )
+		{
+			options.mode = ReadMode::Streamed;
+		}
+		options.huge_pages = parser.has( "huge-pages" );
+		options.chunk_size = parser.get<size_t>( "chunk-size" ).value_or( options.chunk_size );
+		options.io_uring = !parser.has( "no-io-uring" );
+		return options;
+	}
+
 } // namespace reader
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <arena.hpp>
+#include <cache.hpp>
+#include <args.hpp>
+#include <bench.hpp>
+#include <reader.hpp>
+
+namespace solver
+{
+
+	// One day's puzzle. parse() is called once per input before either part; every call must be repeatable, since
+	// --bench runs each phase many times over the same input. The input outlives the solver.
+	class Solver
+	{
+	  public:
+		virtual ~Solver() = default;
+
+		virtual void parse( std::string_view input ) = 0;
+		virtual std::string part1() = 0;
+		virtual std::string part2() = 0;
+
+		// What the parse result allocated, for solvers that keep it in an arena.
+		virtual std::optional<arena::Stats> allocations() const { return std::nullopt; }
+
+		// For --cache, solvers that can flatten their parse result return a non-zero layout, to be bumped whenever
+		// the sections they write change. save() adds the sections, or returns false when this parse result cannot
+		// be cached; load() restores them, or returns false when they do not fit.
+		virtual uint32_t cache_layout() const { return 0; }
+		virtual bool save( cache::Writer & ) const { return false; }
+		virtual bool load( const cache::Reader & ) { return false; }
+	};
+
+	// Calls its argument on every chunk of the input in order, as reader::read_chunks hands them out.
+	using ChunkFeed = std::function<void( const std::function<void( std::string_view )> & )>;
+
+	// A solver whose parser works line by line, so it can also take its input as newline-aligned chunks. With
+	// --read stream these come straight from the file while it is read, and no whole-file buffer exists.
+	class StreamingSolver : public Solver
+	{
+	  public:
+		virtual void parse_chunks( const ChunkFeed &feed ) = 0;
+	};
+
+	using Factory = std::function<std::unique_ptr<Solver>( const args::Parser & )>;
+
+	struct Registration
+	{
+		std::string name;
+		Factory make;
+		bool streams = false;
+
+		// dayN reads dayN/in.txt unless told otherwise.
+		std::string default_input() const { return std::format( "{}/in.txt", name ); }
+	};
+
+	// Every solver linked into the executable, in registration order.
+	inline std::vector<Registration> &registry()
+	{
+		static std::vector<Registration> registrations;
+		return registrations;
+	}
+
+	inline const Registration *find( std::string_view name )
+	{
+		auto it = std::ranges::find( registry(), name, &Registration::name );
+		return it == registry().end() ? nullptr : &*it;
+	}
+
+	// Solvers take the command line when they have options of their own, and are default-constructed otherwise.
+	template <typename T> std::unique_ptr<Solver> make( const args::Parser &parser )
+	{
+		if constexpr( std::is_constructible_v<T, const args::Parser &> )
+		{
+			return std::make_unique<T>( parser );
+		}
+		else
+		{
+			return std::make_unique<T>();
+		}
+	}
+
+	struct Registrar
+	{
+		Registrar( std::string name, Factory make, bool streams )
+		{
+			registry().push_back( { std::move( name ), std::move( make ), streams } );
+		}
+	};
+
+	struct Result
+	{
+		std::string name;
+		std::string part1;
+		std::string part2;
+		// Wall time of the parse, part 1 and part 2 calls that produced the answers.
+		double parse_ms = 0;
+		double part1_ms = 0;
+		double part2_ms = 0;
+		std::optional<arena::Stats> allocations;
+	};
+
+	// Parses the input through parse and answers both parts, through the session so --bench and --profile see every
+	// phase.
+	inline Result solve( const Registration &day, const std::function<void( Solver & )> &parse,
+	                     const args::Parser &parser, bench::Session &session )
+	{
+		auto timed = [&]( std::string_view phase, double &ms, auto &&f ) {
+			auto start = std::chrono::steady_clock::now();
+			auto finish = [&] {
+				ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+			};
+			if constexpr( std::is_void_v<decltype( f() )> )
+			{
+				session.measure( phase, f );
+				finish();
+			}
+			else
+			{
+				auto value = session.measure( phase, f );
+				finish();
+				return value;
+			}
+		};
+
+		Result result{ day.name };
+		auto solver = day.make( parser );
+		timed( "parse", result.parse_ms, [&] { parse( *solver ); } );
+		result.part1 = timed( "part 1", result.part1_ms, [&] { return solver->part1(); } );
+		result.part2 = timed( "part 2", result.part2_ms, [&] { return solver->part2(); } );
+		result.allocations = solver->allocations();
+		return result;
+	}
+
+	// With --cache, the parse result of input read from path is kept next to it in <path>.<day>.cache. A later parse
+	// of an input with the same size and hash loads it from there instead of parsing the text, and any other input
+	// replaces it.
+	inline void parse_cached( Solver &solver, const Registration &day, std::string_view input,
+	                          const std::filesystem::path &path )
+	{
+		const uint32_t layout = solver.cache_layout();
+		if( layout == 0 || path.empty() )
+		{
+			solver.parse( input );
+			return;
+		}
+
+		std::filesystem::path cache_path = path;
+		cache_path += std::format( ".{}.cache", day.name );
+		const uint64_t hash = cache::hash( input );
+		auto cached = cache::Reader::open( cache_path, layout, hash, input.size() );
+		if( cached && solver.load( *cached ) )
+			return;
+
+		solver.parse( input );
+		cache::Writer writer;
+		if( solver.save( writer ) )
+		{
+			writer.write( cache_path, layout, hash, input.size() );
+		}
+	}
+
+	// path names the file input was read from, for --cache.
+	inline Result solve( const Registration &day, std::string_view input, const args::Parser &parser,
+	                     bench::Session &session, const std::filesystem::path &path = {} )
+	{
+		if( parser.has( "cache" ) )
+			return solve( day, [&]( Solver &solver ) { parse_cached( solver, day, input, path ); }, parser, session );
+		return solve( day, [&]( Solver &solver ) { solver.parse( input ); }, parser, session );
+	}
+
+	// For a day that streams: the parse phase reads the file as it goes, so there is no separate read phase.
+	inline Result solve(
+	    const Registration &day, const ChunkFeed &feed, const args::Parser &parser, bench::Session &session )
+	{
+		return solve( day, [&]( Solver &solver ) { static_cast<StreamingSolver &>( solver ).parse_chunks( feed ); },
+		              parser, session );
+	}
+
+	// Feeds the file at path in chunks as reader::read_chunks reads them, throwing if it cannot be read.
+	inline ChunkFeed chunk_feed( std::filesystem::path path, const reader::ReadOptions &options )
+	{
+		return [path = std::move( path ), options]( const std::function<void( std::string_view )> &consume ) {
+			if( !reader::read_chunks( path, consume, options ) )
+			{
+				throw std::runtime_error( std::format( "cannot read {}", path.string() ) );
+			}
+		};
+	}
+
+	// --arena-stats prints what a day's parse result allocated.
+	inline void print_allocations( const args::Parser &parser, const Result &result )
+	{
+		if( !parser.has( "arena-stats" ) || !result.allocations )
+			return;
+		const arena::Stats &stats = *result.allocations;
+		std::println(
+		    "{} arena: {} allocations of {} bytes, served from {} chunks of {} bytes", result.name, stats.allocations,
+		    stats.bytes, stats.chunks, stats.chunk_bytes );
+	}
+
+	// The main() of a single-day executable.
+	inline int run( std::string_view name, int argc, char *argv[] )
+	{
+		args::Parser parser( argc, argv );
+		const Registration *day = find( name );
+		if( !day )
+		{
+			std::println( stderr, "{} is not registered", name );
+			return 1;
+		}
+
+		bench::Session session( parser );
+		const std::string path = parser.get_or( "file", day->default_input() );
+		const reader::ReadOptions options = reader::read_options( parser );
+		const bool streamed = options.mode == reader::ReadMode::Streamed && day->streams;
+		std::expected<reader::FileView, reader::ReadError> file;
+		if( !streamed )
+		{
+			file = session.measure( "read", [&] { return reader::read_file<reader::FileView>( path, options ); } );
+			if( !file )
+			{
+				std::println( stderr, "cannot read {}", path );
+				return 1;
+			}
+		}
+		Result result;
+		try
+		{
+			result = streamed ? solve( *day, chunk_feed( path, options ), parser, session )
+			                  : solve( *day, file->view(), parser, session, path );
+		}
+		catch( const std::exception &e )
+		{
+			std::println( stderr, "{}: {}", name, e.what() );
+			return 1;
+		}
+		std::println( "Part 1: {}", result.part1 );
+		std::println( "" );
+		std::println( "Part 2: {}", result.part2 );
+		print_allocations( parser, result );
+
+		session.report();
+		return 0;
+	}
+
+} // namespace solver
+
+#define AOC_REGISTER_SOLVER( name, type )                                                                              \
+	static const solver::Registrar aoc_registrar_##name(                                                               \
+	    #name, solver::make<type>, std::is_base_of_v<solver::StreamingSolver, type> )
+
+// Registers type as the solver for day `name`. Each dayN/main.cpp ends with one of these: built on its own it also
+// defines main(), while the aoc runner compiles every day with AOC_RUNNER and provides a main() of its own.
+#ifdef AOC_RUNNER
+#define AOC_SOLVER( name, type ) AOC_REGISTER_SOLVER( name, type )
+#else
+#define AOC_SOLVER( name, type )                                                                                       \
+	int main( int argc, char *argv[] ) { return solver::run( #name, argc, argv ); }                                    \
+	AOC_REGISTER_SOLVER( name, type )
+#endif
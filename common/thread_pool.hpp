@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <args.hpp>
+
+namespace tasks
+{
+
+	// Fixed-size work-stealing pool. Each worker owns a deque: it pushes and pops its own tasks at the back, so a
+	// task that splits itself keeps working on warm data, while idle workers steal from the front, where the
+	// oldest and therefore largest pieces sit. Threads outside the pool share one extra deque.
+	//
+	// wait() must be called from outside the pool; the calling thread runs queued tasks until all are done.
+	class ThreadPool
+	{
+	  public:
+		explicit ThreadPool( size_t threads )
+		{
+			threads = std::max<size_t>( threads, 1 );
+			for( size_t i = 0; i <= threads; ++i )
+			{
+				queues_.push_back( std::make_unique<Queue>() );
+			}
+			for( size_t i = 0; i < threads; ++i )
+			{
+				workers_.emplace_back( [this, i]( std::stop_token stop ) { work( i, stop ); } );
+			}
+		}
+
+		ThreadPool( const ThreadPool & ) = delete;
+		ThreadPool &operator=( const ThreadPool & ) = delete;
+
+		~ThreadPool()
+		{
+			for( auto &worker : workers_ )
+			{
+				worker.request_stop();
+			}
+			sleep_.notify_all();
+		}
+
+		size_t size() const { return workers_.size(); }
+
+		// Index of the calling thread in [0, size()]: workers get their own slot, any other thread gets size().
+		// Handy for per-thread partial results sized size() + 1.
+		size_t worker_index() const { return current_pool_ == this ? current_index_ : size(); }
+
+		void submit( std::function<void()> task )
+		{
+			unfinished_.fetch_add( 1, std::memory_order_relaxed );
+			{
+				auto &queue = *queues_[worker_index()];
+				std::lock_guard lock( queue.mutex );
+				queue.tasks.push_back( std::move( task ) );
+			}
+			queued_.fetch_add( 1, std::memory_order_release );
+			{
+				// Taking the sleep mutex orders this push against a worker that is about to go to sleep.
+				std::lock_guard lock( sleep_mutex_ );
+			}
+			sleep_.notify_one();
+		}
+
+		// Runs tasks on the calling thread until every submitted task has finished, then rethrows the first
+		// exception a task threw, if any.
+		void wait()
+		{
+			const size_t self = worker_index();
+			while( true )
+			{
+				const size_t unfinished = unfinished_.load( std::memory_order_acquire );
+				if( unfinished == 0 )
+					break;
+				if( !run_one( self ) )
+				{
+					unfinished_.wait( unfinished, std::memory_order_acquire );
+				}
+			}
+
+			std::exception_ptr error;
+			{
+				std::lock_guard lock( error_mutex_ );
+				error = std::exchange( error_, nullptr );
+			}
+			if( error )
+			{
+				std::rethrow_exception( error );
+			}
+		}
+
+	  private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		void work( size_t index, std::stop_token stop )
+		{
+			current_pool_ = this;
+			current_index_ = index;
+			while( !stop.stop_requested() )
+			{
+				if( run_one( index ) )
+					continue;
+				std::unique_lock lock( sleep_mutex_ );
+				sleep_.wait( lock, stop, [this] { return queued_.load( std::memory_order_acquire ) > 0; } );
+			}
+		}
+
+		bool pop( size_t index, std::function<void()> &task )
+		{
+			auto &own = *queues_[index];
+			{
+				std::lock_guard lock( own.mutex );
+				if( !own.tasks.empty() )
+				{
+					task = std::move( own.tasks.back() );
+					own.tasks.pop_back();
+					return true;
+				}
+			}
+			for( size_t offset = 1; offset < queues_.size(); ++offset )
+			{
+				auto &victim = *queues_[( index + offset ) % queues_.size()];
+				std::lock_guard lock( victim.mutex );
+				if( !victim.tasks.empty() )
+				{
+					task = std::move( victim.tasks.front() );
+					victim.tasks.pop_front();
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool run_one( size_t index )
+		{
+			std::function<void()> task;
+			if( !pop( index, task ) )
+				return false;
+			queued_.fetch_sub( 1, std::memory_order_relaxed );
+
+			try
+			{
+				task();
+			}
+			catch( ... )
+			{
+				std::lock_guard lock( error_mutex_ );
+				if( !error_ )
+				{
+					error_ = std::current_exception();
+				}
+			}
+
+			if( unfinished_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+			{
+				unfinished_.notify_all();
+			}
+			return true;
+		}
+
+		inline static thread_local const ThreadPool *current_pool_ = nullptr;
+		inline static thread_local size_t current_index_ = 0;
+
+		std::vector<std::unique_ptr<Queue>> queues_;
+		std::atomic<size_t> queued_ = 0;
+		std::atomic<size_t> unfinished_ = 0;
+		std::mutex sleep_mutex_;
+		std::condition_variable_any sleep_;
+		std::mutex error_mutex_;
+		std::exception_ptr error_;
+		// Declared last so the workers are joined before the queues they steal from are destroyed.
+		std::vector<std::jthread> workers_;
+	};
+
+	namespace detail
+	{
+		// About eight chunks per thread: enough for stealing to even out uneven items, few enough to keep the
+		// per-chunk task cost negligible.
+		inline size_t default_grain( const ThreadPool &pool, size_t count )
+		{
+			return std::max<size_t>( 1, count / ( 8 * ( pool.size() + 1 ) ) );
+		}
+
+		// Calls f( c ) for every chunk index c in [0, chunks). The index range is halved recursively: each task
+		// keeps the lower half and queues the upper one, so workers split their own share locally and idle
+		// workers steal the largest pieces left.
+		template <typename F> void for_each_chunk( ThreadPool &pool, size_t chunks, F &f )
+		{
+			std::function<void( size_t, size_t )> split = [&]( size_t first, size_t last ) {
+				while( last - first > 1 )
+				{
+					size_t mid = first + ( last - first ) / 2;
+					pool.submit( [&split, mid, last] { split( mid, last ); } );
+					last = mid;
+				}
+				f( first );
+			};
+			pool.submit( [&split, chunks] { split( 0, chunks ); } );
+			pool.wait();
+		}
+	}
+
+	// Calls f( first, last ) over consecutive chunks of [0, count) of grain items each (0 picks a grain from the
+	// pool size), in parallel. Without a pool, f runs once, inline, over the whole range.
+	template <typename F> void parallel_for( ThreadPool *pool, size_t count, F f, size_t grain = 0 )
+	{
+		if( count == 0 )
+			return;
+		if( !pool )
+		{
+			f( size_t{ 0 }, count );
+			return;
+		}
+		grain = grain ? grain : detail::default_grain( *pool, count );
+		auto chunk = [&]( size_t c ) { f( c * grain, std::min( count, ( c + 1 ) * grain ) ); };
+		detail::for_each_chunk( *pool, ( count + grain - 1 ) / grain, chunk );
+	}
+
+	// Reduces [0, count) chunk by chunk: chunk( first, last ) folds its items into a T, and the chunk results are
+	// combined with reduce in index order, so the answer does not depend on scheduling. identity seeds the
+	// combination and must leave any value unchanged under reduce.
+	template <typename T, typename Reduce, typename Chunk>
+	T parallel_reduce_chunks( ThreadPool *pool, size_t count, T identity, Reduce reduce, Chunk chunk, size_t grain = 0 )
+	{
+		if( !pool || count == 0 )
+			return reduce( std::move( identity ), chunk( size_t{ 0 }, count ) );
+
+		grain = grain ? grain : detail::default_grain( *pool, count );
+		std::vector<std::optional<T>> partials( ( count + grain - 1 ) / grain );
+		auto run = [&]( size_t c ) { partials[c].emplace( chunk( c * grain, std::min( count, ( c + 1 ) * grain ) ) ); };
+		detail::for_each_chunk( *pool, partials.size(), run );
+
+		T result = std::move( identity );
+		for( auto &partial : partials )
+		{
+			result = reduce( std::move( result ), std::move( *partial ) );
+		}
+		return result;
+	}
+
+	// transform_reduce over a random-access range, e.g.
+	//
+	//     tasks::parallel_reduce( pool, ranges, uint64_t{ 0 }, std::plus<>{}, sum_invalid_ids );
+	//
+	// identity seeds every chunk, so it must be a true identity of reduce (0 for a sum, 1 for a product).
+	template <std::ranges::random_access_range R, typename T, typename Reduce, typename Transform>
+	T parallel_reduce( ThreadPool *pool, R &&range, T identity, Reduce reduce, Transform transform, size_t grain = 0 )
+	{
+		using difference = std::ranges::range_difference_t<R>;
+		auto chunk = [&]( size_t begin, size_t end ) {
+			T acc = identity;
+			auto it = std::ranges::next( std::ranges::begin( range ), static_cast<difference>( begin ) );
+			for( size_t i = begin; i < end; ++i, ++it )
+			{
+				acc = reduce( std::move( acc ), transform( *it ) );
+			}
+			return acc;
+		};
+		const auto count = static_cast<size_t>( std::ranges::distance( range ) );
+		return parallel_reduce_chunks( pool, count, identity, reduce, chunk, grain );
+	}
+
+	// --threads <n> sets the worker count; 0 means one per hardware thread. Defaults to fallback, 1 (serial) unless
+	// the caller says otherwise.
+	inline size_t thread_count( const args::Parser &parser, int fallback = 1 )
+	{
+		int threads = parser.get<int>( "threads" ).value_or( fallback );
+		if( threads <= 0 )
+		{
+			return std::max( 1u, std::thread::hardware_concurrency() );
+		}
+		return static_cast<size_t>( threads );
+	}
+
+	// Most threads a pool from make_pool may have, or 0 for no limit. A caller that already runs solvers in parallel
+	// sets it: the aoc runner shares --threads out between the days it runs at once.
+	inline std::atomic<size_t> &pool_limit()
+	{
+		static std::atomic<size_t> limit = 0;
+		return limit;
+	}
+
+	// The pool for --threads, or null when that is a single thread, in which case the parallel helpers run inline.
+	inline std::unique_ptr<ThreadPool> make_pool( const args::Parser &parser )
+	{
+		size_t threads = thread_count( parser );
+		if( const size_t limit = pool_limit().load( std::memory_order_relaxed ); limit > 0 )
+		{
+			threads = std::min( threads, limit );
+		}
+		return threads > 1 ? std::make_unique<ThreadPool>( threads ) : nullptr;
+	}
+
+} // namespace tasks
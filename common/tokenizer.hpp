@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#endif
+
+namespace tokenizer
+{
+
+	// Bit i of the result is set when p[i] == c, for every i < n (n <= 64).
+	inline uint64_t match_mask( const char *p, size_t n, char c )
+	{
+		if( n < 64 )
+		{
+			uint64_t mask = 0;
+			for( size_t i = 0; i < n; ++i )
+			{
+				mask |= static_cast<uint64_t>( p[i] == c ) << i;
+			}
+			return mask;
+		}
+#if defined( __AVX2__ )
+		const __m256i needle = _mm256_set1_epi8( c );
+		const __m256i lo = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( p ) );
+		const __m256i hi = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( p + 32 ) );
+		const uint64_t lo_mask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( lo, needle ) ) );
+		const uint64_t hi_mask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( hi, needle ) ) );
+		return lo_mask | hi_mask << 32;
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+		const __m128i needle = _mm_set1_epi8( c );
+		uint64_t mask = 0;
+		for( size_t i = 0; i < 4; ++i )
+		{
+			const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i *>( p + 16 * i ) );
+			const uint16_t bits = static_cast<uint16_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, needle ) ) );
+			mask |= static_cast<uint64_t>( bits ) << ( 16 * i );
+		}
+		return mask;
+#else
+		uint64_t mask = 0;
+		for( size_t i = 0; i < 64; ++i )
+		{
+			mask |= static_cast<uint64_t>( p[i] == c ) << i;
+		}
+		return mask;
+#endif
+	}
+
+	// Walks the positions of a delimiter in [first, last), one 64-byte block at a time.
+	class Scanner
+	{
+	  public:
+		Scanner() = default;
+
+		Scanner( const char *first, const char *last, char delimiter )
+		    : block_( first )
+		    , last_( last )
+		    , delimiter_( delimiter )
+		{
+			load();
+		}
+
+		// Next delimiter position, or last once there are none left.
+		const char *next()
+		{
+			while( mask_ == 0 )
+			{
+				if( last_ - block_ <= 64 )
+					return last_;
+				block_ += 64;
+				load();
+			}
+			const char *match = block_ + std::countr_zero( mask_ );
+			mask_ &= mask_ - 1;
+			return match;
+		}
+
+	  private:
+		void load() { mask_ = match_mask( block_, std::min<size_t>( last_ - block_, 64 ), delimiter_ ); }
+
+		const char *block_ = nullptr;
+		const char *last_ = nullptr;
+		uint64_t mask_ = 0;
+		char delimiter_ = '\n';
+	};
+
+	// Splits a buffer into std::string_view records. A trailing delimiter terminates the last record
+	// instead of starting an empty one, so "a\nb\n" and "a\nb" both yield two records.
+	class Splitter : public std::ranges::view_interface<Splitter>
+	{
+	  public:
+		class iterator
+		{
+		  public:
+			using value_type = std::string_view;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+
+			std::string_view operator*() const { return record_; }
+
+			iterator &operator++()
+			{
+				advance();
+				return *this;
+			}
+
+			iterator operator++( int )
+			{
+				auto copy = *this;
+				advance();
+				return copy;
+			}
+
+			friend bool operator==( const iterator &lhs, const iterator &rhs )
+			{
+				return lhs.done_ == rhs.done_ && ( lhs.done_ || lhs.record_.data() == rhs.record_.data() );
+			}
+			friend bool operator==( const iterator &it, std::default_sentinel_t ) { return it.done_; }
+
+		  private:
+			friend Splitter;
+
+			explicit iterator( const Splitter &splitter )
+			    : cursor_( splitter.input_.data() )
+			    , last_( splitter.input_.data() + splitter.input_.size() )
+			    , skip_empty_( splitter.skip_empty_ )
+			    , trim_cr_( splitter.trim_cr_ )
+			{
+				scanner_ = Scanner( cursor_, last_, splitter.delimiter_ );
+				advance();
+			}
+
+			void advance()
+			{
+				do
+				{
+					const char *stop = scanner_.next();
+					if( stop == last_ && cursor_ == last_ )
+					{
+						done_ = true;
+						return;
+					}
+					record_ = std::string_view( cursor_, stop );
+					cursor_ = stop == last_ ? last_ : stop + 1;
+					if( trim_cr_ && !record_.empty() && record_.back() == '\r' )
+						record_.remove_suffix( 1 );
+				} while( skip_empty_ && record_.empty() );
+			}
+
+			Scanner scanner_;
+			std::string_view record_;
+			const char *cursor_ = nullptr;
+			const char *last_ = nullptr;
+			bool skip_empty_ = false;
+			bool trim_cr_ = false;
+			bool done_ = false;
+		};
+
+		Splitter() = default;
+
+		Splitter( std::string_view input, char delimiter, bool skip_empty = false, bool trim_cr = false )
+		    : input_( input )
+		    , delimiter_( delimiter )
+		    , skip_empty_( skip_empty )
+		    , trim_cr_( trim_cr )
+		{
+		}
+
+		iterator begin() const { return iterator( *this ); }
+		std::default_sentinel_t end() const { return {}; }
+
+	  private:
+		std::string_view input_;
+		char delimiter_ = '\n';
+		bool skip_empty_ = false;
+		bool trim_cr_ = false;
+	};
+
+	// Lines without their "\n" or "\r\n" ending. Empty lines in the middle of the input are kept.
+	inline Splitter lines( std::string_view input ) { return Splitter( input, '\n', false, true ); }
+
+	// Fields separated by a single delimiter, empty fields included.
+	inline Splitter fields( std::string_view input, char delimiter ) { return Splitter( input, delimiter ); }
+
+	// Fields separated by runs of a delimiter, e.g. space-aligned columns.
+	inline Splitter tokens( std::string_view input, char delimiter ) { return Splitter( input, delimiter, true ); }
+
+} // namespace tokenizer
+
+template <> inline constexpr bool std::ranges::enable_borrowed_range<tokenizer::Splitter> = true;
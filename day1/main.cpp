@@ -1,136 +1,324 @@
 #include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <print>
 #include <ranges>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "common.hpp"
 
-struct step
+namespace day1
 {
-	enum class Direction : int32_t
+
+	struct step
 	{
-		Left,
-		Right
-	} direction;
-	int distance;
+		enum class Direction : int32_t
+		{
+			Left,
+			Right
+		} direction;
+		int distance;
+	};
 
-	int operator+( int value ) const { return direction == Direction::Left ? value - distance : value + distance; }
-};
+	// A step packed into one signed delta: negative turns left, positive turns right.
+	using PackedStep = int32_t;
 
-struct ClickEvent
-{
-	int current;
-	int previous;
-	step s;
-};
+	inline PackedStep pack( const step &s ) { return s.direction == step::Direction::Left ? -s.distance : s.distance; }
 
-template <typename T> constexpr T wrap( T x, T min, T max )
-{
-	T range = max - min;
-	return ( ( x - min ) % range + range ) % range + min;
-}
+	struct ClickEvent
+	{
+		int64_t current;
+		int64_t previous;
+		PackedStep delta;
+	};
 
-template <typename T> constexpr T countNumberOfWraps( T start, T delta )
-{
-	if( delta == 0 )
-		return 0;
+	template <typename T> constexpr T wrap( T x, T min, T max )
+	{
+		T range = max - min;
+		return ( ( x - min ) % range + range ) % range + min;
+	}
+
+	template <typename T> constexpr T countNumberOfWraps( T start, T delta )
+	{
+		if( delta == 0 )
+			return 0;
 
-	T dir = delta > 0 ? 1 : -1;
-	T steps = delta > 0 ? delta : -delta;
+		T dir = delta > 0 ? 1 : -1;
+		T steps = delta > 0 ? delta : -delta;
 
-	T end = ( start + dir * steps ) % 100;
-	if( end < 0 )
-		end += 100;
+		T end = ( start + dir * steps ) % 100;
+		if( end < 0 )
+			end += 100;
 
-	T distToZero = ( dir > 0 ) ? ( 100 - start ) % 100 : ( start % 100 );
+		T distToZero = ( dir > 0 ) ? ( 100 - start ) % 100 : ( start % 100 );
 
-	if( distToZero == 0 )
-		distToZero = 100;
+		if( distToZero == 0 )
+			distToZero = 100;
 
-	if( steps < distToZero )
-		return 0;
+		if( steps < distToZero )
+			return 0;
 
-	return 1 + ( steps - distToZero ) / 100;
-}
-std::vector<step> parseFile( std::string_view file )
-{
-	auto lines = std::views::split( file, '\n' );
+		return 1 + ( steps - distToZero ) / 100;
+	}
 
-	std::vector<step> steps;
-	for( const auto &part : lines )
+	step parseStep( std::string_view line )
 	{
-		std::string_view line( part.begin(), part.end() );
 		step s;
 		if( line[0] == 'L' )
 		{
 			s.direction = step::Direction::Left;
-			auto result = std::from_chars( line.data() + 1, line.data() + line.size(), s.distance );
-			if( result.ec != std::errc() )
-			{
-				throw std::runtime_error( "Invalid input" );
-			}
 		}
 		else if( line[0] == 'R' )
 		{
 			s.direction = step::Direction::Right;
-			auto result = std::from_chars( line.data() + 1, line.data() + line.size(), s.distance );
-			if( result.ec != std::errc() )
-			{
-				throw std::runtime_error( "Invalid input" );
-			}
 		}
-		steps.push_back( s );
+		else
+		{
+			throw std::runtime_error( "Invalid input" );
+		}
+
+		auto distance = integer::parse<int>( line.substr( 1 ) );
+		if( !distance )
+		{
+			throw std::runtime_error( "Invalid input" );
+		}
+		s.distance = *distance;
+		return s;
 	}
 
-	return steps;
-}
+	// Hands every step to f as soon as its line is parsed, without storing any of them.
+	template <typename F> void forEachStep( std::string_view file, F f )
+	{
+		for( std::string_view line : tokenizer::lines( file ) )
+		{
+			if( line.empty() )
+				continue;
+			f( pack( parseStep( line ) ) );
+		}
+	}
 
-std::vector<ClickEvent> run( std::vector<step> steps, int start, int max )
-{
-	int current = start;
-	int previous = current;
-	std::vector<ClickEvent> click_events;
+	// Appends the steps of file, which may be one chunk of a longer input.
+	void parseFile( std::string_view file, std::vector<PackedStep> &steps )
+	{
+		forEachStep( file, [&]( PackedStep delta ) { steps.push_back( delta ); } );
+	}
 
-	for( const auto &step : steps )
+	std::vector<ClickEvent> run( std::span<const PackedStep> steps, int64_t start, int64_t max )
 	{
-		current = step + current;
-		current = wrap( current, 0, max );
-		click_events.push_back( { current, previous, step } );
-		previous = current;
+		int64_t current = start;
+		int64_t previous = current;
+		std::vector<ClickEvent> click_events;
+		click_events.reserve( steps.size() );
+
+		for( PackedStep delta : steps )
+		{
+			current = wrap<int64_t>( current + delta, 0, max );
+			click_events.push_back( { current, previous, delta } );
+			previous = current;
+		}
+
+		return click_events;
 	}
 
-	return click_events;
-}
+	// Both parts in a single pass and O(1) memory: fed one step at a time, straight from the parser.
+	struct Dial
+	{
+		int64_t current;
+		int64_t max;
+		int64_t zeros = 0;
+		int64_t wraps = 0;
+
+		void turn( PackedStep delta )
+		{
+			wraps += countNumberOfWraps<int64_t>( current, delta );
+			current = wrap<int64_t>( current + delta, 0, max );
+			zeros += current == 0;
+		}
+	};
+
+	// What a run of steps contributes to each part.
+	struct Counts
+	{
+		int64_t zeros = 0;
+		int64_t wraps = 0;
 
-inline constexpr auto count = std::views::transform( []( auto && ) { return 1; } ) | std::views::common;
+		Counts operator+( const Counts &other ) const { return { zeros + other.zeros, wraps + other.wraps }; }
+	};
 
-int main( int argc, char *argv[] )
-{
-	args::Parser parser( argc, argv );
-	auto file1 = reader::read_file<std::string>( parser.get_or( "file", "day1/in.txt" ) );
-	auto lines = std::views::split( file1.value(), '\n' );
-
-	const int max = 100;
-	int current = 50;
-	std::vector<step> steps = parseFile( file1.value() );
-
-	int password1 =
-	    std::ranges::distance( run( steps, current, max ) | std::views::filter( []( const ClickEvent &event ) {
-		                           return event.current == 0;
-	                           } ) );
-	std::println( "Part 1: {}", password1 );
-	std::println( "" );
-
-	int password2 = std::ranges::fold_left(
-	    run( steps, current, max ) | std::views::transform( []( const ClickEvent &event ) {
-		    return countNumberOfWraps(
-		        event.previous, event.s.direction == step::Direction::Left ? -event.s.distance : event.s.distance );
-	    } ),
-	    0, std::plus<>{} );
-	std::println( "Part 2: {}", password2 );
-
-	return 0;
-}
+	// Division rounding towards negative infinity.
+	constexpr int64_t floorDiv( int64_t x, int64_t d ) { return x / d - ( x % d < 0 ); }
+
+	// Both parts over a run of steps turning from start. Positions are kept unwrapped, so the only dependency from one
+	// step to the next is the running sum and the divisions pipeline: a turn right from a to b passes
+	// floor(b / max) - floor(a / max) zeros and a turn left ceil(a / max) - ceil(b / max), as countNumberOfWraps
+	// counts them, and the dial lands on 0 whenever b is a multiple of max.
+	Counts countSteps( std::span<const PackedStep> steps, int64_t start, int64_t max )
+	{
+		Counts counts;
+		int64_t position = start;
+		for( PackedStep delta : steps )
+		{
+			const int64_t next = position + delta;
+			counts.zeros += next % max == 0;
+			counts.wraps += delta > 0 ? floorDiv( next, max ) - floorDiv( position, max )
+			                          : floorDiv( position - 1, max ) - floorDiv( next - 1, max );
+			position = next;
+		}
+		return counts;
+	}
+
+	// Steps per chunk of the scan: 256 KiB of deltas, small enough to stay in cache between its two passes.
+	inline constexpr size_t scan_chunk = 1 << 16;
+
+	// A turn is modular addition, which is associative, so the walk splits into chunks as a prefix scan: every
+	// chunk sums its net turn independently, an exclusive scan of those sums gives each chunk its starting position,
+	// and then every chunk counts its zeros and wraps independently.
+	Counts scanSteps( tasks::ThreadPool *pool, std::span<const PackedStep> steps, int64_t start, int64_t max )
+	{
+		const size_t chunks = ( steps.size() + scan_chunk - 1 ) / scan_chunk;
+		auto chunk = [&]( size_t c ) {
+			return steps.subspan( c * scan_chunk, std::min( scan_chunk, steps.size() - c * scan_chunk ) );
+		};
+
+		std::vector<int64_t> starts( chunks );
+		tasks::parallel_for(
+		    pool, chunks,
+		    [&]( size_t first, size_t last ) {
+			    for( size_t c = first; c < last; ++c )
+			    {
+				    starts[c] = std::ranges::fold_left( chunk( c ), int64_t{ 0 }, std::plus<>{} );
+			    }
+		    },
+		    1 );
+
+		int64_t position = start;
+		for( int64_t &chunk_start : starts )
+		{
+			const int64_t net = chunk_start;
+			chunk_start = position;
+			position = wrap<int64_t>( position + net, 0, max );
+		}
+
+		return tasks::parallel_reduce_chunks(
+		    pool, chunks, Counts{}, std::plus<>{},
+		    [&]( size_t first, size_t last ) {
+			    Counts counts;
+			    for( size_t c = first; c < last; ++c )
+			    {
+				    counts = counts + countSteps( chunk( c ), starts[c], max );
+			    }
+			    return counts;
+		    },
+		    1 );
+	}
+
+	inline constexpr auto count = std::views::transform( []( auto && ) { return 1; } ) | std::views::common;
+
+	// Streams both parts through a Dial while parsing, in one pass and O(1) memory. --materialize keeps every step
+	// and click event in memory instead and counts each part from them, to cross-check the streaming pass. With
+	// --threads the steps are kept and counted by a parallel scan over chunks of them. Either way the input may
+	// arrive in chunks. With --cache, a whole input's steps are kept so they can be saved; a streamed input is never
+	// cached, so it keeps the O(1) pass.
+	class Solution : public solver::StreamingSolver
+	{
+	  public:
+		explicit Solution( const args::Parser &parser )
+		    : materialize_( parser.has( "materialize" ) )
+		    , pool_( tasks::make_pool( parser ) )
+		    , keep_steps_( materialize_ || pool_ )
+		    , cache_( parser.has( "cache" ) )
+		{
+		}
+
+		void parse( std::string_view input ) override
+		{
+			parse_steps( [&]( const auto &consume ) { consume( input ); }, keep_steps_ || cache_ );
+		}
+
+		void parse_chunks( const solver::ChunkFeed &feed ) override { parse_steps( feed, keep_steps_ ); }
+
+		// The cache holds the steps; the counting is redone from them in place.
+		uint32_t cache_layout() const override { return 1; }
+
+		bool save( cache::Writer &writer ) const override
+		{
+			writer.add( std::span<const PackedStep>( steps_ ) );
+			return true;
+		}
+
+		bool load( const cache::Reader &reader ) override
+		{
+			auto steps = reader.section<PackedStep>( 0 );
+			if( !steps )
+				return false;
+			count( *steps );
+			return true;
+		}
+
+		std::string part1() override
+		{
+			if( !materialize_ )
+				return std::to_string( dial_.zeros );
+			return std::to_string(
+			    std::ranges::count_if( events_, []( const ClickEvent &event ) { return event.current == 0; } ) );
+		}
+
+		std::string part2() override
+		{
+			if( !materialize_ )
+				return std::to_string( dial_.wraps );
+			return std::to_string( std::ranges::fold_left(
+			    events_ | std::views::transform( []( const ClickEvent &event ) {
+				    return countNumberOfWraps<int64_t>( event.previous, event.delta );
+			    } ),
+			    int64_t{ 0 }, std::plus<>{} ) );
+		}
+
+	  private:
+		static constexpr int start = 50;
+		static constexpr int max = 100;
+
+		void parse_steps( const solver::ChunkFeed &feed, bool keep_steps )
+		{
+			if( keep_steps )
+			{
+				steps_.clear();
+				feed( [&]( std::string_view chunk ) { parseFile( chunk, steps_ ); } );
+				count( steps_ );
+				return;
+			}
+			dial_ = Dial{ start, max };
+			feed( [&]( std::string_view chunk ) {
+				forEachStep( chunk, [&]( PackedStep delta ) { dial_.turn( delta ); } );
+			} );
+		}
+
+		void count( std::span<const PackedStep> steps )
+		{
+			if( materialize_ )
+			{
+				events_ = run( steps, start, max );
+				return;
+			}
+			const Counts counts = scanSteps( pool_.get(), steps, start, max );
+			dial_ = Dial{ start, max, counts.zeros, counts.wraps };
+		}
+
+		bool materialize_;
+		std::unique_ptr<tasks::ThreadPool> pool_;
+		// The modes that count from a whole vector of steps keep it; --cache keeps it only for a whole input.
+		bool keep_steps_;
+		bool cache_;
+		std::vector<PackedStep> steps_;
+		Dial dial_{ start, max };
+		std::vector<ClickEvent> events_;
+	};
+
+} // namespace day1
+
+AOC_SOLVER( day1, day1::Solution );
@@ -1,128 +1,407 @@
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cmath>
 #include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <print>
 #include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "common.hpp"
 
-struct Ranges
+namespace day2
 {
-	uint64_t first_id;
-	uint64_t last_id;
-};
 
-std::vector<Ranges> parse_input( std::string_view file )
-{
-	std::vector<Ranges> ranges;
-	auto parts = std::views::split( file, ',' );
-	for( auto part : parts )
+	struct Ranges
 	{
-		auto subparts = std::views::split( part, '-' );
-		auto it = std::ranges::begin( subparts );
-		auto first = std::stoull( std::string( std::ranges::begin( *it ), std::ranges::end( *it ) ) );
-		++it;
-		auto second = std::stoull( std::string( std::ranges::begin( *it ), std::ranges::end( *it ) ) );
-		ranges.push_back( { first, second } );
-	}
+		uint64_t first_id;
+		uint64_t last_id;
+	};
 
-	return ranges;
-}
+	std::vector<Ranges> parse_input( std::string_view file )
+	{
+		std::vector<Ranges> ranges;
+		for( std::string_view line : tokenizer::lines( file ) )
+		{
+			for( std::string_view part : tokenizer::fields( line, ',' ) )
+			{
+				auto subparts = tokenizer::fields( part, '-' );
+				auto it = subparts.begin();
+				auto first = integer::parse<uint64_t>( *it ).value();
+				++it;
+				auto second = integer::parse<uint64_t>( *it ).value();
+				ranges.push_back( { first, second } );
+			}
+		}
 
-size_t dec_size( const uint64_t id )
-{
-	if( id == 0 )
-		return 1;
-	return static_cast<int>( std::log10( id ) ) + 1;
-}
+		return ranges;
+	}
 
-bool is_valid_id( const uint64_t id )
-{
-	size_t size = dec_size( id );
-	uint64_t divisor = static_cast<uint64_t>( std::pow( 10, size / 2 ) );
-	uint64_t first = id % divisor;
-	uint64_t second = id / divisor;
-	return first != second;
-}
-
-std::vector<uint64_t> divisors( uint64_t n )
-{
-	std::vector<uint64_t> result;
-	uint64_t sqrt_n = static_cast<uint64_t>( std::sqrt( n ) );
+	size_t dec_size( const uint64_t id )
+	{
+		if( id == 0 )
+			return 1;
+		return static_cast<int>( std::log10( id ) ) + 1;
+	}
 
-	for( uint64_t i = 1; i <= sqrt_n; ++i )
+	bool is_valid_id( const uint64_t id )
 	{
-		if( n % i == 0 )
+		size_t size = dec_size( id );
+		uint64_t divisor = static_cast<uint64_t>( std::pow( 10, size / 2 ) );
+		uint64_t first = id % divisor;
+		uint64_t second = id / divisor;
+		return first != second;
+	}
+
+	std::vector<uint64_t> divisors( uint64_t n )
+	{
+		std::vector<uint64_t> result;
+		uint64_t sqrt_n = static_cast<uint64_t>( std::sqrt( n ) );
+
+		for( uint64_t i = 1; i <= sqrt_n; ++i )
 		{
-			result.push_back( i );
-			if( i != n / i )
-				result.push_back( n / i );
+			if( n % i == 0 )
+			{
+				result.push_back( i );
+				if( i != n / i )
+					result.push_back( n / i );
+			}
 		}
+		std::ranges::sort( result );
+		return result;
 	}
-	std::ranges::sort( result );
-	return result;
-}
 
-bool is_valid_id_complex( uint64_t id )
-{
-	size_t size = dec_size( id );
-	auto divs = divisors( size );
-	divs.pop_back();
-	for( uint64_t i : divs )
+	bool is_valid_id_complex( uint64_t id )
 	{
-		uint64_t divisor = static_cast<uint64_t>( std::pow( 10, i ) );
-		std::vector<uint64_t> parts( size / i );
-		uint64_t local_id = id;
-
-		for( uint64_t j = 0; j < size / i; ++j )
+		size_t size = dec_size( id );
+		auto divs = divisors( size );
+		divs.pop_back();
+		for( uint64_t i : divs )
 		{
-			parts[j] = local_id % divisor;
-			local_id /= divisor;
+			uint64_t divisor = static_cast<uint64_t>( std::pow( 10, i ) );
+			std::vector<uint64_t> parts( size / i );
+			uint64_t local_id = id;
+
+			for( uint64_t j = 0; j < size / i; ++j )
+			{
+				parts[j] = local_id % divisor;
+				local_id /= divisor;
+			}
+			bool all_equal = std::ranges::all_of( std::next( parts.begin() ), parts.end(), [&]( const uint64_t &part ) {
+				return parts.front() == part;
+			} );
+			if( all_equal )
+			{
+				return false;
+			}
 		}
-		bool all_equal = std::ranges::all_of(
-		    std::next( parts.begin() ), parts.end(), [&]( const uint64_t &part ) { return parts.front() == part; } );
-		if( all_equal )
+		return true;
+	}
+
+	template <typename Predicate>
+	uint64_t sum_invalid_ids_brute_force( const std::vector<Ranges> &ranges, Predicate is_valid )
+	{
+		uint64_t output = 0;
+		for( auto &range : ranges )
 		{
-			return false;
+			for( uint64_t id = range.first_id; id <= range.last_id; ++id )
+			{
+				if( !is_valid( id ) )
+				{
+					output += id;
+				}
+			}
 		}
+		return output;
 	}
-	return true;
-}
 
-int main( int argc, char *argv[] )
-{
-	args::Parser parser( argc, argv );
-	auto file1 = reader::read_file<std::string>( parser.get_or( "file", "day2/in.txt" ) );
-	std::vector<Ranges> ranges = parse_input( file1.value() );
-	uint64_t output = 0;
+	// Ids per task once a range has been split down; large enough to amortize queueing, small enough to balance.
+	inline constexpr uint64_t brute_force_grain = 1 << 14;
 
-	for( auto &range : ranges )
+	template <typename Predicate>
+	uint64_t sum_invalid_ids_parallel( tasks::ThreadPool &pool, const std::vector<Ranges> &ranges, Predicate is_valid )
 	{
-		for( uint64_t id = range.first_id; id <= range.last_id; ++id )
+		// One slot per pool thread plus the waiting caller, padded so partial sums never share a cache line.
+		struct alignas( 64 ) Partial
+		{
+			uint64_t sum = 0;
+		};
+		std::vector<Partial> partials( pool.size() + 1 );
+
+		// A wide range keeps halving, leaving its upper half on this worker's deque for idle threads to steal.
+		std::function<void( uint64_t, uint64_t )> process = [&]( uint64_t first, uint64_t last ) {
+			while( last - first > brute_force_grain )
+			{
+				uint64_t mid = first + ( last - first ) / 2;
+				pool.submit( [&process, mid, last] { process( mid + 1, last ); } );
+				last = mid;
+			}
+
+			uint64_t sum = 0;
+			for( uint64_t id = first;; ++id )
+			{
+				if( !is_valid( id ) )
+				{
+					sum += id;
+				}
+				if( id == last )
+					break;
+			}
+			partials[pool.worker_index()].sum += sum;
+		};
+
+		for( const auto &range : ranges )
 		{
-			if( !is_valid_id( id ) )
+			if( range.first_id <= range.last_id )
 			{
-				output += id;
+				pool.submit( [&process, range] { process( range.first_id, range.last_id ); } );
 			}
 		}
+		pool.wait();
+
+		return std::ranges::fold_left( partials, 0ull, []( uint64_t acc, const Partial &p ) { return acc + p.sum; } );
 	}
-	std::print( "Part 1: {}\n", output );
 
-	output = 0;
-	for( auto &range : ranges )
+	inline constexpr std::array<uint64_t, 20> powers_of_10 = [] {
+		std::array<uint64_t, 20> powers{};
+		uint64_t power = 1;
+		for( auto &p : powers )
+		{
+			p = power;
+			power *= 10;
+		}
+		return powers;
+	}();
+
+	inline constexpr size_t max_digits = powers_of_10.size();
+
+	// Sum of the ids in [first, last] made of one `period`-digit block repeated, where multiplier is
+	// 1 + 10^period + 10^(2 * period) + ... up to the ids' length. Sums wrap modulo 2^64 exactly like the
+	// brute-force accumulator does.
+	constexpr uint64_t sum_repeated( uint64_t first, uint64_t last, uint64_t multiplier, size_t period )
 	{
-		for( uint64_t id = range.first_id; id <= range.last_id; ++id )
+		// Each such id is block * multiplier, for every block without a leading zero.
+		uint64_t lo = std::max( powers_of_10[period - 1], first / multiplier + ( first % multiplier != 0 ) );
+		uint64_t hi = std::min( powers_of_10[period] - 1, last / multiplier );
+		if( lo > hi )
+			return 0;
+
+		uint64_t count = hi - lo + 1;
+		uint64_t block_sum = count % 2 == 0 ? ( count / 2 ) * ( lo + hi ) : ( ( lo + hi ) / 2 ) * count;
+		return multiplier * block_sum;
+	}
+
+	// Möbius function, for the small digit counts we factor.
+	constexpr int mobius( size_t n )
+	{
+		int result = 1;
+		for( size_t p = 2; p * p <= n; ++p )
 		{
-			if( !is_valid_id_complex( id ) )
+			if( n % p == 0 )
 			{
-				output += id;
+				n /= p;
+				if( n % p == 0 )
+					return 0;
+				result = -result;
 			}
 		}
+		return n > 1 ? -result : result;
+	}
+
+	// Estimated as bit_width * 1233 / 4096, where 1233 / 4096 is just below log10( 2 ). The estimate is therefore the
+	// digit count or one less, never more, and one comparison with a power of 10 adds the missing digit.
+	constexpr size_t digit_count( uint64_t id )
+	{
+		const size_t estimate = ( static_cast<size_t>( std::bit_width( id ) ) * 1233 ) >> 12;
+		return estimate + ( estimate < max_digits && id >= powers_of_10[estimate] );
 	}
-	std::println( "Part 2: {}", output );
 
-	return 0;
-}
+	// The sum of invalid ids of one kind up to any id, from a table built at compile time. The ids themselves are
+	// far too many to list (the 18-digit ids made of two equal halves alone number 9 * 10^8), so the table holds,
+	// per digit length, the repeated-block terms whose signed sums give that length's invalid ids, and prefix sums
+	// of those over whole lengths. Summing up to x is then one prefix lookup plus the terms of x's own length, and
+	// a range is the difference of two such sums. Being constexpr, the table lives in the executable's read-only
+	// data, mapped like any other page of it.
+	class InvalidIdIndex
+	{
+	  public:
+		// complex selects is_valid_id_complex's notion of invalid, a block repeated at least twice, over
+		// is_valid_id's, exactly twice.
+		constexpr explicit InvalidIdIndex( bool complex )
+		{
+			for( size_t length = 1; length <= max_digits; ++length )
+			{
+				Terms &terms = terms_[length];
+				auto add = [&]( size_t repeats, int sign ) {
+					const size_t period = length / repeats;
+					uint64_t multiplier = 0;
+					for( size_t i = 0; i < length; i += period )
+					{
+						multiplier += powers_of_10[i];
+					}
+					terms.terms[terms.count++] = { multiplier, period, sign };
+				};
+
+				if( !complex )
+				{
+					if( length % 2 == 0 )
+					{
+						add( 2, 1 );
+					}
+				}
+				else
+				{
+					// An id with period p also has every multiple of p dividing its length as a period, so
+					// inclusion-exclusion over the prime factors k of the length gives the union: the sum over
+					// squarefree k > 1 dividing the length of -mobius( k ) * S( length / k ).
+					for( size_t k = 2; k <= length; ++k )
+					{
+						if( length % k == 0 && mobius( k ) != 0 )
+						{
+							add( k, -mobius( k ) );
+						}
+					}
+				}
+
+				const uint64_t highest =
+				    length < max_digits ? powers_of_10[length] - 1 : std::numeric_limits<uint64_t>::max();
+				prefix_[length] = prefix_[length - 1] + sum_within( powers_of_10[length - 1], highest, terms );
+			}
+		}
+
+		// Sum of the invalid ids in [1, x], modulo 2^64.
+		constexpr uint64_t sum_up_to( uint64_t x ) const
+		{
+			if( x == 0 )
+				return 0;
+			const size_t length = digit_count( x );
+			return prefix_[length - 1] + sum_within( powers_of_10[length - 1], x, terms_[length] );
+		}
+
+		// Ranges within one length, the common case for short ones, need that length's terms just once.
+		constexpr uint64_t sum( const Ranges &range ) const
+		{
+			if( range.first_id > range.last_id )
+				return 0;
+			const size_t length = digit_count( range.first_id );
+			if( range.first_id > 0 && length == digit_count( range.last_id ) )
+				return sum_within( range.first_id, range.last_id, terms_[length] );
+			return sum_up_to( range.last_id ) - ( range.first_id == 0 ? 0 : sum_up_to( range.first_id - 1 ) );
+		}
+
+	  private:
+		struct Term
+		{
+			uint64_t multiplier = 0;
+			size_t period = 0;
+			int sign = 0;
+		};
+
+		// A length of at most 20 digits has at most 3 squarefree divisors above 1.
+		struct Terms
+		{
+			std::array<Term, 3> terms{};
+			size_t count = 0;
+		};
+
+		// Sum of the invalid ids in [first, last], which all have the length the terms belong to.
+		static constexpr uint64_t sum_within( uint64_t first, uint64_t last, const Terms &terms )
+		{
+			uint64_t output = 0;
+			for( size_t i = 0; i < terms.count; ++i )
+			{
+				const Term &term = terms.terms[i];
+				const uint64_t sum = sum_repeated( first, last, term.multiplier, term.period );
+				output = term.sign > 0 ? output + sum : output - sum;
+			}
+			return output;
+		}
+
+		// Indexed by digit length; entry 0 is unused by terms_ and 0 in prefix_.
+		std::array<Terms, max_digits + 1> terms_{};
+		std::array<uint64_t, max_digits + 1> prefix_{};
+	};
+
+	inline constexpr InvalidIdIndex invalid_ids( false );
+	inline constexpr InvalidIdIndex invalid_ids_complex( true );
+
+	// Ids rejected by is_valid_id: an even number of digits made of two equal halves.
+	uint64_t sum_invalid_ids( const Ranges &range ) { return invalid_ids.sum( range ); }
+
+	// Ids rejected by is_valid_id_complex: a block repeated at least twice.
+	uint64_t sum_invalid_ids_complex( const Ranges &range ) { return invalid_ids_complex.sum( range ); }
+
+	// Spot checks against ids worked out by hand.
+	static_assert( invalid_ids.sum( { 11, 22 } ) == 33 );
+	static_assert( invalid_ids.sum( { 95, 115 } ) == 99 );
+	static_assert( invalid_ids_complex.sum( { 95, 115 } ) == 99 + 111 );
+	static_assert( invalid_ids_complex.sum( { 998, 1012 } ) == 999 + 1010 );
+
+	// Sums the invalid ids of each range in closed form. --brute-force checks every id with the per-id predicates
+	// instead, to cross-check the closed form. With --threads above 1 the ranges are spread over a work-stealing pool,
+	// and brute force also splits wide ranges into pieces.
+	class Solution : public solver::Solver
+	{
+	  public:
+		explicit Solution( const args::Parser &parser )
+		    : brute_force_( parser.has( "brute-force" ) )
+		    , pool_( tasks::make_pool( parser ) )
+		{
+		}
+
+		void parse( std::string_view input ) override { ranges_ = parse_input( input ); }
+
+		uint32_t cache_layout() const override { return 1; }
+
+		bool save( cache::Writer &writer ) const override
+		{
+			writer.add( std::span<const Ranges>( ranges_ ) );
+			return true;
+		}
+
+		bool load( const cache::Reader &reader ) override
+		{
+			auto ranges = reader.section<Ranges>( 0 );
+			if( !ranges )
+				return false;
+			ranges_.assign( ranges->begin(), ranges->end() );
+			return true;
+		}
+
+		std::string part1() override
+		{
+			if( brute_force_ )
+				return std::to_string( brute_force_sum( is_valid_id ) );
+			return std::to_string(
+			    tasks::parallel_reduce( pool_.get(), ranges_, uint64_t{ 0 }, std::plus<>{}, sum_invalid_ids ) );
+		}
+
+		std::string part2() override
+		{
+			if( brute_force_ )
+				return std::to_string( brute_force_sum( is_valid_id_complex ) );
+			return std::to_string(
+			    tasks::parallel_reduce( pool_.get(), ranges_, uint64_t{ 0 }, std::plus<>{}, sum_invalid_ids_complex ) );
+		}
+
+	  private:
+		template <typename Predicate> uint64_t brute_force_sum( Predicate is_valid )
+		{
+			return pool_ ? sum_invalid_ids_parallel( *pool_, ranges_, is_valid )
+			             : sum_invalid_ids_brute_force( ranges_, is_valid );
+		}
+
+		bool brute_force_;
+		std::unique_ptr<tasks::ThreadPool> pool_;
+		std::vector<Ranges> ranges_;
+	};
+
+} // namespace day2
+
+AOC_SOLVER( day2, day2::Solution );
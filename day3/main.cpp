@@ -1,8 +1,15 @@
 #include <algorithm>
-#include <cmath>
+#include <array>
 #include <cstdint>
+#include <format>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <print>
 #include <ranges>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -10,96 +17,283 @@
 
 #include "common.hpp"
 
-std::vector<std::vector<uint64_t>> parseFile( std::string_view file )
+namespace day3
 {
-	auto lines = std::views::split( file, '\n' );
 
-	std::vector<std::vector<uint64_t>> packs;
-	for( const auto &line : lines )
+	// All packs back to back in one buffer, one byte per digit: pack i is digits[offsets[i], offsets[i + 1]).
+	struct Packs
 	{
-		std::vector<uint64_t> pack;
-		for( auto it = line.begin(); it != line.end(); ++it )
+		explicit Packs( std::pmr::memory_resource *resource )
+		    : digits( resource )
+		    , offsets( 1, 0, resource )
 		{
-			char c = *it;
-			if( c > '9' || c < '0' )
+		}
+
+		std::pmr::vector<uint8_t> digits;
+		std::pmr::vector<size_t> offsets;
+
+		size_t size() const { return offsets.size() - 1; }
+
+		std::span<const uint8_t> operator[]( size_t i ) const
+		{
+			return std::span( digits ).subspan( offsets[i], offsets[i + 1] - offsets[i] );
+		}
+	};
+
+	Packs parseFile( std::string_view file, std::pmr::memory_resource *resource = std::pmr::get_default_resource() )
+	{
+		Packs packs( resource );
+		packs.digits.reserve( file.size() );
+		for( std::string_view line : tokenizer::lines( file ) )
+		{
+			if( line.empty() )
 				continue;
-			pack.push_back( c - '0' );
+			for( char c : line )
+			{
+				if( c > '9' || c < '0' )
+					continue;
+				packs.digits.push_back( static_cast<uint8_t>( c - '0' ) );
+			}
+			packs.offsets.push_back( packs.digits.size() );
 		}
-		packs.push_back( pack );
+
+		return packs;
 	}
 
-	return packs;
-}
+	// Picks the N digits forming the largest number, as (index, digit) pairs, in one pass: a monotonic stack where
+	// each digit evicts smaller digits before it, as long as enough digits remain to still fill all N slots.
+	template <size_t N>
+	std::array<std::pair<uint64_t, uint64_t>, N> findMaxIndexesGeneric( std::span<const uint8_t> pack )
+	{
+		std::array<std::pair<uint64_t, uint64_t>, N> maxIndexes{};
+		size_t top = 0;
+		for( size_t i = 0; i < pack.size(); ++i )
+		{
+			const uint64_t digit = pack[i];
+			const size_t remaining = pack.size() - i;
+			while( top > 0 && maxIndexes[top - 1].second < digit && top - 1 + remaining >= N )
+			{
+				--top;
+			}
+			if( top < N )
+			{
+				maxIndexes[top++] = { i, digit };
+			}
+		}
+		return maxIndexes;
+	}
 
-template <size_t N>
-std::array<std::pair<uint64_t, uint64_t>, N> findMaxIndexesGeneric( const std::vector<uint64_t> &packs )
-{
-	std::array<std::pair<uint64_t, uint64_t>, N> maxIndexes{};
+	template <size_t N> constexpr std::array<uint64_t, N> makePowersOf10()
+	{
+		std::array<uint64_t, N> result{};
+		uint64_t power = 1;
+		for( size_t i = 0; i < N; ++i )
+		{
+			result[N - 1 - i] = power;
+			power *= 10;
+		}
+		return result;
+	}
 
-	auto maxIt = std::ranges::max_element( packs.begin(), packs.end() - N + 1 );
-	maxIndexes[0].first = std::distance( packs.begin(), maxIt );
-	maxIndexes[0].second = *maxIt;
-	for( size_t i = 1; i < N; ++i )
+	template <size_t N> uint64_t sumIndexes( const std::array<std::pair<uint64_t, uint64_t>, N> &maxIndexes )
 	{
-		auto maxIt = std::ranges::max_element( packs.begin() + maxIndexes[i - 1].first + 1, packs.end() - N + i + 1 );
-		maxIndexes[i].first = std::distance( packs.begin(), maxIt );
-		maxIndexes[i].second = *maxIt;
+		constexpr auto powers = makePowersOf10<N>();
+		uint64_t sum = 0;
+		for( size_t i = 0; i < N; ++i )
+		{
+			sum += maxIndexes[i].second * powers[i];
+		}
+		return sum;
 	}
-	return maxIndexes;
-}
 
-template <size_t N> constexpr std::array<uint64_t, N> makePowersOf10()
-{
-	std::array<uint64_t, N> result{};
-	uint64_t power = 1;
-	for( size_t i = 0; i < N; ++i )
+	// The most digits whose number still fits in 64 bits.
+	inline constexpr size_t max_digits = 19;
+
+	// Runtime-n counterpart of findMaxIndexesGeneric and sumIndexes: the same monotonic stack, summed as it goes.
+	uint64_t maxNumberRuntime( std::span<const uint8_t> pack, size_t n )
 	{
-		result[N - 1 - i] = power;
-		power *= 10;
+		std::array<uint8_t, max_digits> stack{};
+		size_t top = 0;
+		for( size_t i = 0; i < pack.size(); ++i )
+		{
+			const uint8_t digit = pack[i];
+			const size_t remaining = pack.size() - i;
+			while( top > 0 && stack[top - 1] < digit && top - 1 + remaining >= n )
+			{
+				--top;
+			}
+			if( top < n )
+			{
+				stack[top++] = digit;
+			}
+		}
+		uint64_t number = 0;
+		for( size_t i = 0; i < n; ++i )
+		{
+			number = number * 10 + ( i < top ? stack[i] : 0 );
+		}
+		return number;
 	}
-	return result;
-}
 
-template <size_t N> uint64_t sumIndexes( const std::array<std::pair<uint64_t, uint64_t>, N> &maxIndexes )
-{
-	constexpr auto powers = makePowersOf10<N>();
-	uint64_t sum = 0;
-	for( size_t i = 0; i < N; ++i )
+	// Largest number formed by N digits of the pack, in order; N = 0 takes n at run time instead.
+	template <size_t N> uint64_t maxNumber( std::span<const uint8_t> pack, size_t n )
 	{
-		sum += maxIndexes[i].second * powers[i];
+		if constexpr( N == 0 )
+		{
+			return maxNumberRuntime( pack, n );
+		}
+		else
+		{
+			return sumIndexes( findMaxIndexesGeneric<N>( pack ) );
+		}
 	}
-	return sum;
-}
 
-int main( int argc, char *argv[] )
-{
-	args::Parser parser( argc, argv );
-	auto file1 = reader::read_file<std::string>( parser.get_or( "file", "day3/in.txt" ) );
-	std::vector<std::vector<uint64_t>> packs = parseFile( file1.value() );
-
-	auto start1 = std::chrono::high_resolution_clock::now();
-	uint64_t part1 = std::ranges::fold_left(
-	    packs | std::views::transform( []( const auto &pack ) {
-		    auto indexes = findMaxIndexesGeneric<2>( pack );
-		    uint64_t sum = sumIndexes( indexes );
-		    return sum;
-	    } ),
-	    0, std::plus<>{} );
-	auto end1 = std::chrono::high_resolution_clock::now();
-	auto duration1 = std::chrono::duration_cast<std::chrono::microseconds>( end1 - start1 );
-	std::println( "Part 1: {} (took {} µs)", part1, duration1.count() );
-
-	auto start2 = std::chrono::high_resolution_clock::now();
-	uint64_t part2 = std::ranges::fold_left(
-	    packs | std::views::transform( []( const auto &pack ) {
-		    auto indexes = findMaxIndexesGeneric<12>( pack );
-		    uint64_t sum = sumIndexes( indexes );
-		    return sum;
-	    } ),
-	    0, std::plus<>{} );
-	auto end2 = std::chrono::high_resolution_clock::now();
-	auto duration2 = std::chrono::duration_cast<std::chrono::microseconds>( end2 - start2 );
-	std::println( "Part 2: {} (took {} µs)", part2, duration2.count() );
-
-	return 0;
-}
+	// Packs evaluated side by side by the batched kernel.
+	inline constexpr size_t batch_lanes = 16;
+
+	// The largest number of N (or, for N = 0, n) digits of up to batch_lanes packs of the same length, at least n
+	// digits long, starting at pack first. One lane per pack: after each digit, best[k] holds the largest number
+	// made of k digits seen so far, and a digit d updates it to max( best[k], 10 * best[k - 1] + d ) from the top
+	// down. Every lane runs the same branch-free steps, so the lane loop vectorizes. Starting from 0 instead of
+	// "impossible" is harmless: a number padded with leading zeros is never larger than one that uses real digits.
+	template <size_t N> uint64_t sumBatch( const Packs &packs, size_t first, size_t count, size_t n )
+	{
+		if constexpr( N != 0 )
+		{
+			n = N;
+		}
+		std::array<const uint8_t *, batch_lanes> lanes;
+		for( size_t lane = 0; lane < batch_lanes; ++lane )
+		{
+			lanes[lane] = packs[first + std::min( lane, count - 1 )].data();
+		}
+
+		alignas( 64 ) std::array<std::array<uint64_t, batch_lanes>, max_digits + 1> best{};
+		const size_t length = packs[first].size();
+		for( size_t i = 0; i < length; ++i )
+		{
+			alignas( 64 ) std::array<uint64_t, batch_lanes> digit;
+			for( size_t lane = 0; lane < batch_lanes; ++lane )
+			{
+				digit[lane] = lanes[lane][i];
+			}
+			for( size_t k = n; k > 0; --k )
+			{
+				for( size_t lane = 0; lane < batch_lanes; ++lane )
+				{
+					best[k][lane] = std::max( best[k][lane], best[k - 1][lane] * 10 + digit[lane] );
+				}
+			}
+		}
+		return std::ranges::fold_left( std::span( best[n] ).first( count ), uint64_t{ 0 }, std::plus<>{} );
+	}
+
+	// Runs of consecutive packs of one length go through sumBatch, batch_lanes at a time; packs too short for n
+	// digits take the scalar path. Batches are independent, so they are spread over the pool when there is one.
+	template <size_t N> uint64_t sumMaxNumbers( tasks::ThreadPool *pool, const Packs &packs, size_t n )
+	{
+		struct Batch
+		{
+			size_t first;
+			size_t count;
+		};
+		std::vector<Batch> batches;
+		for( size_t i = 0; i < packs.size(); )
+		{
+			size_t end = i + 1;
+			while( end < packs.size() && end - i < batch_lanes && packs[end].size() == packs[i].size() )
+			{
+				++end;
+			}
+			batches.push_back( { i, end - i } );
+			i = end;
+		}
+
+		return tasks::parallel_reduce( pool, batches, uint64_t{ 0 }, std::plus<>{}, [&]( const Batch &batch ) {
+			if( packs[batch.first].size() >= n && batch.count > 1 )
+				return sumBatch<N>( packs, batch.first, batch.count, n );
+			uint64_t sum = 0;
+			for( size_t i = batch.first; i < batch.first + batch.count; ++i )
+			{
+				sum += maxNumber<N>( packs[i], n );
+			}
+			return sum;
+		} );
+	}
+
+	// Sum over every pack of its largest n-digit number. The puzzle's sizes get compile-time paths.
+	uint64_t sumMaxNumbers( tasks::ThreadPool *pool, const Packs &packs, size_t n )
+	{
+		if( n == 0 || n > max_digits )
+		{
+			throw std::out_of_range( std::format( "cannot pick {} digits; 1 to {} fit in 64 bits", n, max_digits ) );
+		}
+		switch( n )
+		{
+		case 2:
+			return sumMaxNumbers<2>( pool, packs, n );
+		case 12:
+			return sumMaxNumbers<12>( pool, packs, n );
+		default:
+			return sumMaxNumbers<0>( pool, packs, n );
+		}
+	}
+
+	class Solution : public solver::Solver
+	{
+	  public:
+		explicit Solution( const args::Parser &parser )
+		    : pool_( tasks::make_pool( parser ) )
+		    , digits_( parser.get<size_t>( "digits" ).value_or( 12 ) )
+		{
+		}
+
+		void parse( std::string_view input ) override
+		{
+			packs_ = arena::Region<Packs>(
+			    input.size(), [&]( std::pmr::memory_resource *resource ) { return parseFile( input, resource ); } );
+		}
+
+		uint32_t cache_layout() const override { return 1; }
+
+		bool save( cache::Writer &writer ) const override
+		{
+			writer.add( std::span<const uint8_t>( packs_->digits ) );
+			writer.add( std::span<const size_t>( packs_->offsets ) );
+			return true;
+		}
+
+		bool load( const cache::Reader &reader ) override
+		{
+			auto digits = reader.section<uint8_t>( 0 );
+			auto offsets = reader.section<size_t>( 1 );
+			// Offsets that do not run from 0 up to the end of the digits would index past them.
+			if( !digits || !offsets || offsets->empty() || offsets->front() != 0 ||
+			    !std::ranges::is_sorted( *offsets ) || offsets->back() != digits->size() )
+				return false;
+			packs_ = arena::Region<Packs>(
+			    digits->size() + offsets->size_bytes(), [&]( std::pmr::memory_resource *resource ) {
+				    Packs packs( resource );
+				    packs.digits.assign( digits->begin(), digits->end() );
+				    packs.offsets.assign( offsets->begin(), offsets->end() );
+				    return packs;
+			    } );
+			return true;
+		}
+
+		std::string part1() override { return std::to_string( sumMaxNumbers( pool_.get(), *packs_, 2 ) ); }
+
+		std::string part2() override { return std::to_string( sumMaxNumbers( pool_.get(), *packs_, digits_ ) ); }
+
+		std::optional<arena::Stats> allocations() const override { return packs_.stats(); }
+
+	  private:
+		std::unique_ptr<tasks::ThreadPool> pool_;
+		// --digits <n> picks part 2's number length.
+		size_t digits_;
+		arena::Region<Packs> packs_;
+	};
+
+} // namespace day3
+
+AOC_SOLVER( day3, day3::Solution );
@@ -1,89 +1,269 @@
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
-#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <optional>
 #include <print>
 #include <ranges>
-#include <set>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
-#include <utility>
+#include <vector>
 
 #include "common.hpp"
 
-struct Map
+namespace day4
 {
-	std::set<std::pair<int, int>> rolls;
-	std::set<std::pair<int, int>> positions;
-};
 
-std::pair<int, int> operator+( const std::pair<int, int> &lhs, const std::pair<int, int> &rhs )
-{
-	return { lhs.first + rhs.first, lhs.second + rhs.second };
-}
+	// One bit per cell, 64 cells per word, bit x % 64 of word x / 64 holding column x. Every row has a zero guard
+	// word on each side and the grid a zero guard row above and below, so neighbour reads need no bounds checks.
+	struct BitGrid
+	{
+		size_t width = 0;
+		size_t height = 0;
+		size_t words = 0;
+		size_t stride = 0;
+		std::pmr::vector<uint64_t> bits;
 
-Map parseFile( std::string_view file )
-{
-	auto lines = std::views::split( file, '\n' );
+		explicit BitGrid( std::pmr::memory_resource *resource = std::pmr::get_default_resource() )
+		    : bits( resource )
+		{
+		}
+
+		explicit BitGrid( size_t width, std::pmr::memory_resource *resource = std::pmr::get_default_resource() )
+		    : width( width )
+		    , words( ( width + 63 ) / 64 )
+		    , stride( words + 2 )
+		    , bits( 2 * stride, 0, resource )
+		{
+		}
+
+		uint64_t *row( size_t y ) { return bits.data() + ( y + 1 ) * stride + 1; }
+		const uint64_t *row( size_t y ) const { return bits.data() + ( y + 1 ) * stride + 1; }
+
+		// Appends an empty row in front of the bottom guard row.
+		uint64_t *addRow()
+		{
+			bits.insert( bits.end() - stride, stride, 0 );
+			return row( height++ );
+		}
+
+		bool test( size_t x, size_t y ) const { return row( y )[x / 64] >> ( x % 64 ) & 1; }
+
+		uint64_t count() const
+		{
+			return std::ranges::fold_left(
+			    bits, 0ull, []( uint64_t acc, uint64_t word ) { return acc + std::popcount( word ); } );
+		}
+	};
+
+	struct Map
+	{
+		explicit Map( std::pmr::memory_resource *resource )
+		    : rolls( resource )
+		{
+		}
 
-	Map map;
+		BitGrid rolls;
+	};
 
-	int y = 0;
-	for( const auto &line : lines )
+	Map parseFile( std::string_view file, std::pmr::memory_resource *resource = std::pmr::get_default_resource() )
 	{
-		int x = 0;
-		for( char c : line )
+		Map map( resource );
+
+		for( std::string_view line : tokenizer::lines( file ) )
 		{
-			if( c == '.' )
+			if( line.empty() )
+				continue;
+			if( map.rolls.width == 0 )
 			{
-				map.positions.insert( { x, y } );
+				// Same resource, so the move keeps the arena storage.
+				map.rolls = BitGrid( line.size(), resource );
+				// Rows are appended one by one; reserving for the expected height avoids regrowing in the arena.
+				map.rolls.bits.reserve( ( file.size() / line.size() + 2 ) * map.rolls.stride );
 			}
-			else if( c == '@' )
+
+			uint64_t *row = map.rolls.addRow();
+			size_t width = std::min( line.size(), map.rolls.width );
+			for( size_t x = 0; x < width; x += 64 )
 			{
-				map.rolls.insert( { x, y } );
+				row[x / 64] = tokenizer::match_mask( line.data() + x, std::min<size_t>( width - x, 64 ), '@' );
 			}
-			++x;
 		}
-		++y;
+
+		return map;
+	}
+
+	// Bit-sliced adders: every bit lane of the words is an independent cell.
+	inline void halfAdd( uint64_t a, uint64_t b, uint64_t &sum, uint64_t &carry )
+	{
+		sum = a ^ b;
+		carry = a & b;
+	}
+
+	inline void fullAdd( uint64_t a, uint64_t b, uint64_t c, uint64_t &sum, uint64_t &carry )
+	{
+		uint64_t partial = a ^ b;
+		sum = partial ^ c;
+		carry = ( a & b ) | ( partial & c );
 	}
 
-	return map;
-}
+	// Rolls with fewer than 4 rolls among their 8 neighbours, for a whole word of cells at once.
+	inline uint64_t accessibleWord( const uint64_t *up, const uint64_t *mid, const uint64_t *down, size_t w )
+	{
+		// Bit x of west( r ) holds cell x - 1 and bit x of east( r ) holds cell x + 1, carried across words.
+		auto west = [w]( const uint64_t *r ) { return ( r[w] << 1 ) | ( r[w - 1] >> 63 ); };
+		auto east = [w]( const uint64_t *r ) { return ( r[w] >> 1 ) | ( r[w + 1] << 63 ); };
 
-inline constexpr std::array<std::pair<int, int>, 8> directions = {
-	{ { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } }
-};
+		// Sum the eight neighbour bits of every lane. Only "at least 4" matters, so the ones digit is dropped once
+		// its carries are known: each carry weighs 2 and any carry out of them reaches 4.
+		uint64_t ones0, twos0, ones1, twos1, ones2, twos2, ones, twos3;
+		fullAdd( west( up ), up[w], east( up ), ones0, twos0 );
+		fullAdd( west( mid ), east( mid ), west( down ), ones1, twos1 );
+		halfAdd( down[w], east( down ), ones2, twos2 );
+		fullAdd( ones0, ones1, ones2, ones, twos3 );
 
-bool isValidPosition( std::set<std::pair<int, int>> &rolls, std::pair<int, int> pos )
-{
-	auto count = std::ranges::count_if( directions, [&]( const auto &dir ) {
-		auto newPos = pos + dir;
-		return rolls.contains( newPos );
-	} );
-	return count < 4;
-}
-
-int main( int argc, char *argv[] )
-{
-	args::Parser parser( argc, argv );
-	auto file1 = reader::read_file<std::string>( parser.get_or( "file", "day4/in.txt" ) );
-	auto map = parseFile( file1.value() );
+		uint64_t twos01, fours0, twos, fours1;
+		fullAdd( twos0, twos1, twos2, twos01, fours0 );
+		halfAdd( twos01, twos3, twos, fours1 );
+		return mid[w] & ~( fours0 | fours1 );
+	}
 
-	uint64_t part1 = std::ranges::distance(
-	    map.rolls | std::views::filter( [&]( const auto &pos ) { return isValidPosition( map.rolls, pos ); } ) );
-	std::println( "Part 1: {}", part1 );
+	BitGrid accessibleRolls( const BitGrid &rolls )
+	{
+		BitGrid result = rolls;
+		for( size_t y = 0; y < rolls.height; ++y )
+		{
+			const uint64_t *up = rolls.row( y ) - rolls.stride;
+			const uint64_t *mid = rolls.row( y );
+			const uint64_t *down = rolls.row( y ) + rolls.stride;
+			uint64_t *out = result.row( y );
+			for( size_t w = 0; w < rolls.words; ++w )
+			{
+				out[w] = accessibleWord( up, mid, down, w );
+			}
+		}
+		return result;
+	}
 
-	auto part2 = 0;
-	auto rolls = map.rolls;
-	while( true )
+	// Removes accessible rolls until none are left and returns how many went. Each roll keeps its neighbour count;
+	// removing one only touches its 8 neighbours and queues those that just dropped below 4. Counts only decrease,
+	// so every roll is queued at most once and the peel is linear in the grid size.
+	uint64_t peelRolls( const BitGrid &rolls )
 	{
-		auto newRolls = rolls | std::views::filter( [&]( const auto &pos ) { return !isValidPosition( rolls, pos ); } );
-		auto count = rolls.size() - std::ranges::distance( newRolls );
-		if( count == 0 )
-			break;
-		rolls = newRolls | std::ranges::to<std::set>();
-		part2 += count;
+		// One byte per cell of the grid plus a one-cell border: the neighbour count of a roll, or `empty`.
+		constexpr uint8_t empty = 0xFF;
+		const size_t stride = rolls.width + 2;
+		const std::array<ptrdiff_t, 8> neighbours = {
+			-ptrdiff_t( stride ) - 1, -ptrdiff_t( stride ), -ptrdiff_t( stride ) + 1, -1, 1,
+			ptrdiff_t( stride ) - 1,  ptrdiff_t( stride ),  ptrdiff_t( stride ) + 1
+		};
+
+		// The queue holds cell indices as uint32_t, half the size of size_t.
+		const size_t padded = stride * ( rolls.height + 2 );
+		if( padded > std::numeric_limits<uint32_t>::max() )
+		{
+			throw std::runtime_error( "Grid too large to peel" );
+		}
+		std::vector<uint8_t> cells( padded, empty );
+		for( size_t y = 0; y < rolls.height; ++y )
+		{
+			for( size_t x = 0; x < rolls.width; ++x )
+			{
+				if( rolls.test( x, y ) )
+				{
+					cells[( y + 1 ) * stride + x + 1] = 0;
+				}
+			}
+		}
+
+		std::vector<uint32_t> queue;
+		for( size_t i = 0; i < cells.size(); ++i )
+		{
+			if( cells[i] == empty )
+				continue;
+			cells[i] = static_cast<uint8_t>(
+			    std::ranges::count_if( neighbours, [&]( ptrdiff_t offset ) { return cells[i + offset] != empty; } ) );
+			if( cells[i] < 4 )
+			{
+				queue.push_back( static_cast<uint32_t>( i ) );
+			}
+		}
+
+		uint64_t removed = 0;
+		while( !queue.empty() )
+		{
+			size_t i = queue.back();
+			queue.pop_back();
+			cells[i] = empty;
+			++removed;
+			for( ptrdiff_t offset : neighbours )
+			{
+				uint8_t &neighbour = cells[i + offset];
+				if( neighbour != empty && neighbour-- == 4 )
+				{
+					queue.push_back( static_cast<uint32_t>( i + offset ) );
+				}
+			}
+		}
+		return removed;
 	}
-	std::println( "Part 2: {}", part2 );
 
-	return 0;
-}
+	class Solution : public solver::Solver
+	{
+	  public:
+		void parse( std::string_view input ) override
+		{
+			map_ = arena::Region<Map>(
+			    input.size() / 2, [&]( std::pmr::memory_resource *resource ) { return parseFile( input, resource ); } );
+		}
+
+		// The grid's dimensions, then its words, guard rows and columns included.
+		uint32_t cache_layout() const override { return 1; }
+
+		bool save( cache::Writer &writer ) const override
+		{
+			const BitGrid &rolls = map_->rolls;
+			writer.add_value( std::array<uint64_t, 4>{ rolls.width, rolls.height, rolls.words, rolls.stride } );
+			writer.add( std::span<const uint64_t>( rolls.bits ) );
+			return true;
+		}
+
+		bool load( const cache::Reader &reader ) override
+		{
+			auto dimensions = reader.value<std::array<uint64_t, 4>>( 0 );
+			auto bits = reader.section<uint64_t>( 1 );
+			if( !dimensions || !bits )
+				return false;
+			const auto [width, height, words, stride] = *dimensions;
+			if( words != ( width + 63 ) / 64 || stride != words + 2 || bits->size() != ( height + 2 ) * stride )
+				return false;
+			map_ = arena::Region<Map>( bits->size_bytes(), [&]( std::pmr::memory_resource *resource ) {
+				Map map( resource );
+				map.rolls.width = width;
+				map.rolls.height = height;
+				map.rolls.words = words;
+				map.rolls.stride = stride;
+				map.rolls.bits.assign( bits->begin(), bits->end() );
+				return map;
+			} );
+			return true;
+		}
+
+		std::string part1() override { return std::to_string( accessibleRolls( map_->rolls ).count() ); }
+
+		std::string part2() override { return std::to_string( peelRolls( map_->rolls ) ); }
+
+		std::optional<arena::Stats> allocations() const override { return map_.stats(); }
+
+	  private:
+		arena::Region<Map> map_;
+	};
+
+} // namespace day4
+
+AOC_SOLVER( day4, day4::Solution );
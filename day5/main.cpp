@@ -1,82 +1,369 @@
 #include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <print>
 #include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "common.hpp"
 
-struct Database
+namespace day5
 {
-	std::vector<std::pair<uint64_t, uint64_t>> ranges;
-	std::vector<uint64_t> ingredients;
-};
 
-Database parse_file( std::string_view file )
-{
-	Database db;
-	bool ranges = true;
-	auto lines = std::views::split( file, '\n' );
-
-	for( auto line : lines )
+	struct Database
 	{
-		if( *line.begin() == '\r' )
+		explicit Database( std::pmr::memory_resource *resource )
+		    : ranges( resource )
+		    , ingredients( resource )
 		{
-			ranges = false;
-			continue;
 		}
 
-		if( ranges )
+		std::pmr::vector<std::pair<uint64_t, uint64_t>> ranges;
+		std::pmr::vector<uint64_t> ingredients;
+	};
+
+	// Parses one newline-aligned piece of the input into db. in_ingredients carries over, from one piece to the next,
+	// whether the blank line between the ranges and the ingredient ids has been passed.
+	void parse_chunk( std::string_view chunk, Database &db, bool &in_ingredients )
+	{
+		if( !in_ingredients )
 		{
-			auto numbers = std::views::split( line, '-' );
-			uint64_t start = std::stoull( std::string( ( *numbers.begin() ).begin(), ( *numbers.begin() ).end() ) );
-			uint64_t end = std::stoull(
-			    std::string( ( *std::next( numbers.begin() ) ).begin(), ( *std::next( numbers.begin() ) ).end() ) );
-			db.ranges.push_back( { start, end } );
+			for( std::string_view line : tokenizer::lines( chunk ) )
+			{
+				if( line.empty() )
+				{
+					size_t separator_end = chunk.find( '\n', line.data() - chunk.data() );
+					chunk = chunk.substr( separator_end == std::string_view::npos ? chunk.size() : separator_end + 1 );
+					in_ingredients = true;
+					break;
+				}
+
+				auto numbers = tokenizer::fields( line, '-' );
+				uint64_t start = integer::parse<uint64_t>( *numbers.begin() ).value();
+				uint64_t end = integer::parse<uint64_t>( *std::next( numbers.begin() ) ).value();
+				db.ranges.push_back( { start, end } );
+			}
+			if( !in_ingredients )
+				return;
 		}
-		else
+
+		const size_t parsed = db.ingredients.size();
+		db.ingredients.resize( parsed + integer::count_records( chunk, '\n' ) );
+		size_t count = integer::parse_column( chunk, '\n', std::span( db.ingredients ).subspan( parsed ) ).value();
+		db.ingredients.resize( parsed + count );
+	}
+
+	// Sorts the ranges in place and merges overlapping or touching ones into disjoint ranges covering the same ids.
+	std::vector<std::pair<uint64_t, uint64_t>> merge_ranges( std::span<std::pair<uint64_t, uint64_t>> ranges )
+	{
+		std::vector<std::pair<uint64_t, uint64_t>> merged;
+		if( ranges.empty() )
+			return merged;
+
+		std::ranges::sort( ranges, {}, &std::pair<uint64_t, uint64_t>::first );
+		merged.push_back( ranges.front() );
+		for( size_t i = 1; i < ranges.size(); ++i )
 		{
-			db.ingredients.push_back( std::stoull( std::string( line.begin(), line.end() ) ) );
+			// Compared as first - 1 so a range ending at the largest id does not wrap around.
+			if( ranges[i].first == 0 || ranges[i].first - 1 <= merged.back().second )
+			{
+				merged.back().second = std::max( merged.back().second, ranges[i].second );
+			}
+			else
+			{
+				merged.push_back( ranges[i] );
+			}
 		}
+		return merged;
 	}
 
-	return db;
-}
+	// Freshness lookups over merged ranges. Starts are stored in Eytzinger (breadth-first) order of a descending
+	// sort, so a branchless descent lands on the last range starting at or before the id, and the top levels of
+	// the tree share a handful of cache lines.
+	class FreshIndex
+	{
+	  public:
+		explicit FreshIndex( std::vector<std::pair<uint64_t, uint64_t>> merged )
+		    : sorted_( std::move( merged ) )
+		    , starts_( sorted_.size() + 1 )
+		    , ends_( sorted_.size() + 1 )
+		{
+			size_t next = sorted_.size();
+			build( 1, next );
+		}
 
-bool is_fresh( std::vector<std::pair<uint64_t, uint64_t>> &ranges, uint64_t ingredient )
-{
-	return std::ranges::any_of(
-	    ranges, [ingredient]( const auto &range ) { return ingredient >= range.first && ingredient <= range.second; } );
-}
+		bool contains( uint64_t id ) const
+		{
+			size_t k = search( id );
+			return ( k != 0 ) & ( id <= ends_[k] );
+		}
 
-int main( int argc, char *argv[] )
-{
-	args::Parser parser( argc, argv );
-	auto file1 = reader::read_file<std::string>( parser.get_or( "file", "day5/in.txt" ) );
-	Database db = parse_file( file1.value() );
+		// Answers a whole batch: out[i] is 1 when ids[i] is fresh.
+		void contains( std::span<const uint64_t> ids, std::span<uint8_t> out ) const
+		{
+			for( size_t i = 0; i < ids.size(); ++i )
+			{
+				out[i] = contains( ids[i] );
+			}
+		}
+
+		// Number of fresh ids in a batch. Large batches are sorted and swept against the ranges in one merge pass,
+		// which streams both arrays instead of doing a random tree descent per id.
+		size_t count_fresh( std::span<const uint64_t> ids ) const
+		{
+			if( ids.size() < sweep_factor * sorted_.size() )
+			{
+				return std::ranges::count_if( ids, [this]( uint64_t id ) { return contains( id ); } );
+			}
+
+			std::vector<uint64_t> queries( ids.begin(), ids.end() );
+			std::ranges::sort( queries );
+			size_t fresh = 0;
+			auto range = sorted_.begin();
+			for( uint64_t id : queries )
+			{
+				while( range != sorted_.end() && range->second < id )
+				{
+					++range;
+				}
+				if( range == sorted_.end() )
+					break;
+				fresh += id >= range->first;
+			}
+			return fresh;
+		}
+
+	  private:
+		// Batches at least this many times larger than the range count use the sort-and-sweep path.
+		static constexpr size_t sweep_factor = 8;
+
+		// In-order walk of the implicit tree, handing out ranges from the largest start down.
+		void build( size_t k, size_t &next )
+		{
+			if( k >= starts_.size() )
+				return;
+			build( 2 * k, next );
+			--next;
+			starts_[k] = sorted_[next].first;
+			ends_[k] = sorted_[next].second;
+			build( 2 * k + 1, next );
+		}
 
-	uint64_t part1 = std::ranges::count_if( db.ingredients, [&]( uint64_t i ) { return is_fresh( db.ranges, i ); } );
-	std::println( "Par1: {}", part1 );
+		// Node of the last range whose start is <= id, or 0 when every range starts after it.
+		size_t search( uint64_t id ) const
+		{
+			const size_t n = starts_.size() - 1;
+			size_t k = 1;
+			while( k <= n )
+			{
+				// Three levels down, the 8 descendants of k are contiguous: fetch them while this level resolves. Near
+				// the leaves they lie past the end, and the last node is fetched instead.
+				__builtin_prefetch( starts_.data() + std::min( 8 * k, n ) );
+				k = 2 * k + ( starts_[k] > id );
+			}
+			return k >> ( std::countr_one( k ) + 1 );
+		}
+
+		std::vector<std::pair<uint64_t, uint64_t>> sorted_;
+		std::vector<uint64_t> starts_;
+		std::vector<uint64_t> ends_;
+	};
 
-	std::ranges::sort( db.ranges, {}, &std::pair<uint64_t, uint64_t>::first );
-	std::vector<std::pair<uint64_t, uint64_t>> merged = { db.ranges.front() };
-	for( size_t i = 1; i < db.ranges.size(); ++i )
+	// Disjoint ranges that stay merged under interleaved inserts and lookups: a range joins every range it overlaps
+	// or touches, lookups are a tree descent, and the number of covered ids is kept up to date as ranges merge.
+	class IntervalSet
 	{
-		if( db.ranges[i].first <= merged.back().second + 1 )
+	  public:
+		explicit IntervalSet( std::pmr::memory_resource *resource = std::pmr::get_default_resource() )
+		    : ranges_( resource )
 		{
-			merged.back().second = std::max( merged.back().second, db.ranges[i].second );
 		}
-		else
+
+		void insert( uint64_t first, uint64_t last )
 		{
-			merged.push_back( db.ranges[i] );
+			auto it = ranges_.upper_bound( first );
+			if( it != ranges_.begin() )
+			{
+				auto previous = std::prev( it );
+				if( last <= previous->second )
+					return;
+				// Compared as first - 1 so a range starting at 0 does not wrap around.
+				if( first == 0 || first - 1 <= previous->second )
+				{
+					it = previous;
+				}
+			}
+			while( it != ranges_.end() && ( last == max_id || it->first <= last + 1 ) )
+			{
+				first = std::min( first, it->first );
+				last = std::max( last, it->second );
+				covered_ -= it->second - it->first + 1;
+				it = ranges_.erase( it );
+			}
+			ranges_.emplace_hint( it, first, last );
+			covered_ += last - first + 1;
 		}
+
+		bool contains( uint64_t id ) const
+		{
+			auto it = ranges_.upper_bound( id );
+			return it != ranges_.begin() && id <= std::prev( it )->second;
+		}
+
+		// Ids in the union of every range inserted so far (wraps to 0 if that is all 2^64 of them).
+		uint64_t covered() const { return covered_; }
+
+		size_t size() const { return ranges_.size(); }
+
+	  private:
+		static constexpr uint64_t max_id = std::numeric_limits<uint64_t>::max();
+
+		// First id of each range to its last.
+		std::pmr::map<uint64_t, uint64_t> ranges_;
+		uint64_t covered_ = 0;
+	};
+
+	// Replays the input as a feed, in order: a range line is inserted into the set, an id line is looked up against
+	// the ranges seen so far. Blank lines are skipped, so ranges and ids may interleave freely. Returns the number of
+	// ids found fresh when they were looked up.
+	size_t replay_feed( std::string_view file, IntervalSet &fresh )
+	{
+		size_t found = 0;
+		for( std::string_view line : tokenizer::lines( file ) )
+		{
+			if( line.empty() )
+				continue;
+			if( size_t dash = line.find( '-' ); dash != std::string_view::npos )
+			{
+				fresh.insert( integer::parse<uint64_t>( line.substr( 0, dash ) ).value(),
+				              integer::parse<uint64_t>( line.substr( dash + 1 ) ).value() );
+			}
+			else
+			{
+				found += fresh.contains( integer::parse<uint64_t>( line ).value() );
+			}
+		}
+		return found;
 	}
-	uint64_t part2 = std::ranges::fold_left(
-	    merged, 0ull, []( uint64_t acc, const auto &range ) { return acc + range.second - range.first + 1; } );
-	std::println( "Par2: {}", part2 );
 
-	return 0;
-}
+	// Parsing also merges the ranges and builds the index, so both parts only answer queries. With --online the
+	// input is instead replayed as a feed through an IntervalSet, which answers both parts as it goes. Either way
+	// the input may arrive in chunks.
+	class Solution : public solver::StreamingSolver
+	{
+	  public:
+		explicit Solution( const args::Parser &parser )
+		    : pool_( tasks::make_pool( parser ) )
+		    , online_( parser.has( "online" ) )
+		{
+		}
+
+		void parse( std::string_view input ) override
+		{
+			load( [&]( const auto &consume ) { consume( input ); }, input.size() );
+		}
+
+		void parse_chunks( const solver::ChunkFeed &feed ) override { load( feed, streamed_arena_size ); }
+
+		// Each chunk of ingredients is counted on its own, picking search or sweep for its size.
+		std::string part1() override
+		{
+			if( online_ )
+				return std::to_string( online_found_ );
+			std::span<const uint64_t> ingredients( db_->ingredients );
+			return std::to_string( tasks::parallel_reduce_chunks(
+			    pool_.get(), ingredients.size(), size_t{ 0 }, std::plus<>{}, [&]( size_t first, size_t last ) {
+				    return index_.count_fresh( ingredients.subspan( first, last - first ) );
+			    } ) );
+		}
+
+		std::string part2() override
+		{
+			if( online_ )
+				return std::to_string( fresh_.covered() );
+			return std::to_string( tasks::parallel_reduce(
+			    pool_.get(), merged_, uint64_t{ 0 }, std::plus<>{},
+			    []( const auto &range ) { return range.second - range.first + 1; } ) );
+		}
+
+		std::optional<arena::Stats> allocations() const override { return db_.stats(); }
+
+		// The feed of --online is answered as it is read, so only the batch parse is cached.
+		uint32_t cache_layout() const override { return 1; }
+
+		bool save( cache::Writer &writer ) const override
+		{
+			if( online_ )
+				return false;
+			writer.add( std::span<const std::pair<uint64_t, uint64_t>>( db_->ranges ) );
+			writer.add( std::span<const uint64_t>( db_->ingredients ) );
+			return true;
+		}
+
+		bool load( const cache::Reader &reader ) override
+		{
+			auto ranges = reader.section<std::pair<uint64_t, uint64_t>>( 0 );
+			auto ingredients = reader.section<uint64_t>( 1 );
+			if( online_ || !ranges || !ingredients )
+				return false;
+			db_ = arena::Region<Database>(
+			    ranges->size_bytes() + ingredients->size_bytes(), [&]( std::pmr::memory_resource *resource ) {
+				    Database db( resource );
+				    db.ranges.assign( ranges->begin(), ranges->end() );
+				    db.ingredients.assign( ingredients->begin(), ingredients->end() );
+				    return db;
+			    } );
+			merged_ = merge_ranges( db_->ranges );
+			index_ = FreshIndex( merged_ );
+			return true;
+		}
+
+	  private:
+		// First arena chunk when the input size is not known up front.
+		static constexpr size_t streamed_arena_size = 64 * 1024;
+
+		void load( const solver::ChunkFeed &feed, size_t arena_size )
+		{
+			if( online_ )
+			{
+				fresh_ = IntervalSet( &nodes_ );
+				online_found_ = 0;
+				feed( [&]( std::string_view chunk ) { online_found_ += replay_feed( chunk, fresh_ ); } );
+				return;
+			}
+			db_ = arena::Region<Database>( arena_size, [&]( std::pmr::memory_resource *resource ) {
+				Database db( resource );
+				bool in_ingredients = false;
+				feed( [&]( std::string_view chunk ) { parse_chunk( chunk, db, in_ingredients ); } );
+				return db;
+			} );
+			merged_ = merge_ranges( db_->ranges );
+			index_ = FreshIndex( merged_ );
+		}
+
+		std::unique_ptr<tasks::ThreadPool> pool_;
+		bool online_;
+		arena::Region<Database> db_;
+		std::vector<std::pair<uint64_t, uint64_t>> merged_;
+		FreshIndex index_{ {} };
+
+		// Set nodes are freed as ranges merge, so they come from a pool that recycles them rather than the arena.
+		std::pmr::unsynchronized_pool_resource nodes_;
+		IntervalSet fresh_{ &nodes_ };
+		size_t online_found_ = 0;
+	};
+
+} // namespace day5
+
+AOC_SOLVER( day5, day5::Solution );
@@ -1,149 +1,393 @@
 #include <algorithm>
+#include <array>
 #include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <print>
 #include <ranges>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "common.hpp"
 
-enum class Operation : uint32_t
+namespace day6
 {
-	UNKNOWN,
-	ADD,
-	MULTIPLY
-};
 
-inline constexpr uint64_t apply_operation( Operation op, uint64_t a, uint64_t b )
-{
-	switch( op )
-	{
-	case Operation::ADD:
-		return a + b;
-	case Operation::MULTIPLY:
-		return a * b;
-	default:
-		return 0;
+	enum class Operation : uint32_t
+	{
+		UNKNOWN,
+		ADD,
+		MULTIPLY
+	};
+
+	// Every problem's numbers back to back in one buffer: problem i is numbers[offsets[i], offsets[i + 1]).
+	struct Problems
+	{
+		explicit Problems( std::pmr::memory_resource *resource )
+		    : numbers( resource )
+		    , offsets( 1, 0, resource )
+		    , operations( resource )
+		{
+		}
+
+		std::pmr::vector<uint64_t> numbers;
+		std::pmr::vector<size_t> offsets;
+		std::pmr::vector<Operation> operations;
+
+		size_t size() const { return operations.size(); }
+
+		std::span<const uint64_t> operator[]( size_t i ) const
+		{
+			return std::span( numbers ).subspan( offsets[i], offsets[i + 1] - offsets[i] );
+		}
+
+		// Ends the problem whose numbers were appended last.
+		void close() { offsets.push_back( numbers.size() ); }
+
+		bool open() const { return numbers.size() > offsets.back(); }
+	};
+
+	inline Operation parse_operator( std::string_view sv )
+	{
+		if( sv == "+" )
+			return Operation::ADD;
+		else if( sv == "*" )
+			return Operation::MULTIPLY;
+		return Operation::UNKNOWN;
 	}
-}
 
-struct Problem
-{
-	std::vector<uint64_t> numbers;
-	Operation operation;
-};
+	struct ParsedInput
+	{
+		std::pmr::vector<std::string_view> lines;
+		Problems problems;
+	};
 
-inline std::string_view trim_line_ending( std::string_view sv )
-{
-	if( !sv.empty() && sv.back() == '\r' )
-		sv.remove_suffix( 1 );
-	return sv;
-}
+	ParsedInput parse_common( std::string_view file, std::pmr::memory_resource *resource )
+	{
+		ParsedInput result{
+			tokenizer::lines( file ) | std::ranges::to<std::pmr::vector<std::string_view>>( resource ),
+			Problems( resource ),
+		};
+		if( result.lines.empty() )
+		{
+			throw std::runtime_error( "Invalid input" );
+		}
 
-inline Operation parse_operator( std::string_view sv )
-{
-	if( sv == "+" )
-		return Operation::ADD;
-	else if( sv == "*" )
-		return Operation::MULTIPLY;
-	return Operation::UNKNOWN;
-}
-
-struct ParsedInput
-{
-	std::vector<std::string_view> lines;
-	std::vector<Problem> problems;
-};
+		auto operators = tokenizer::tokens( result.lines.back(), ' ' ) | std::views::transform( parse_operator ) |
+		                 std::views::filter( []( auto op ) { return op != Operation::UNKNOWN; } );
 
-ParsedInput parse_common( std::string_view file )
-{
-	ParsedInput result;
+		std::ranges::copy( operators, std::back_inserter( result.problems.operations ) );
+
+		return result;
+	}
 
-	result.lines = std::views::split( file, '\n' ) | std::views::transform( []( auto line ) {
-		               return trim_line_ending( std::string_view( line.begin(), line.end() ) );
-	               } ) |
-	               std::ranges::to<std::vector>();
+	// Plain uint64_t arithmetic, wrapping on overflow like the puzzle answers have always been computed.
+	struct Wrapping
+	{
+		using value_type = uint64_t;
 
-	auto operators = std::views::split( result.lines.back(), ' ' ) | std::views::transform( []( auto str ) {
-		                 return parse_operator( std::string_view( str.begin(), str.end() ) );
-	                 } ) |
-	                 std::views::filter( []( auto op ) { return op != Operation::UNKNOWN; } );
+		static void add( value_type &acc, uint64_t x, bool & ) { acc += x; }
+		static void multiply( value_type &acc, uint64_t x, bool & ) { acc *= x; }
+		static void check( bool ) {}
+	};
 
-	std::ranges::for_each( operators, [&]( auto op ) { result.problems.push_back( { {}, op } ); } );
+#ifdef __SIZEOF_INT128__
+	// 128-bit arithmetic that records overflow instead of wrapping. The flag is only tested once a whole reduction
+	// is done, so the loops stay branch-free.
+	struct Checked
+	{
+		using value_type = unsigned __int128;
 
-	return result;
-}
+		static void add( value_type &acc, value_type x, bool &overflow )
+		{
+			overflow |= __builtin_add_overflow( acc, x, &acc );
+		}
+		static void multiply( value_type &acc, value_type x, bool &overflow )
+		{
+			overflow |= __builtin_mul_overflow( acc, x, &acc );
+		}
+		static void check( bool overflow )
+		{
+			if( overflow )
+			{
+				throw std::overflow_error( "day6 result does not fit in 128 bits" );
+			}
+		}
+	};
 
-uint64_t compute_result( const std::vector<Problem> &problems )
-{
-	return std::ranges::fold_left( problems, 0ull, []( auto acc, const auto &problem ) {
-		return acc + std::ranges::fold_left(
-		                 problem.numbers | std::views::drop( 1 ), problem.numbers.front(),
-		                 [&]( auto acc, auto num ) { return apply_operation( problem.operation, acc, num ); } );
-	} );
-}
-
-std::vector<Problem> parse_file( std::string_view file )
-{
-	auto [lines, problems] = parse_common( file );
+	std::string to_string( unsigned __int128 value )
+	{
+		std::string digits;
+		do
+		{
+			digits.push_back( static_cast<char>( '0' + static_cast<int>( value % 10 ) ) );
+			value /= 10;
+		} while( value != 0 );
+		std::ranges::reverse( digits );
+		return digits;
+	}
+#endif
 
-	for( auto line : lines | std::views::take( lines.size() - 1 ) )
+	// One kernel per operation, so the operator is resolved once per problem instead of once per number and the
+	// loop body is a bare add or multiply the compiler can vectorize.
+	template <typename Arithmetic, Operation op>
+	typename Arithmetic::value_type reduce( std::span<const uint64_t> numbers, bool &overflow )
 	{
-		auto numbers = std::views::split( line, ' ' ) |
-		               std::views::filter( []( auto str ) { return !std::string_view( str ).empty(); } );
+		typename Arithmetic::value_type acc = op == Operation::MULTIPLY ? 1 : 0;
+		for( uint64_t number : numbers )
+		{
+			if constexpr( op == Operation::MULTIPLY )
+			{
+				Arithmetic::multiply( acc, number, overflow );
+			}
+			else
+			{
+				Arithmetic::add( acc, number, overflow );
+			}
+		}
+		return acc;
+	}
 
-		size_t counter = 0;
-		for( auto number : numbers )
+	// Sum of the answers to problems [first, last).
+	template <typename Arithmetic>
+	typename Arithmetic::value_type evaluate( const Problems &problems, size_t first, size_t last, bool &overflow )
+	{
+		typename Arithmetic::value_type total = 0;
+		for( size_t i = first; i < last; ++i )
 		{
-			problems[counter++].numbers.push_back( std::stoull( std::string( number.begin(), number.end() ) ) );
+			Arithmetic::add(
+			    total,
+			    problems.operations[i] == Operation::MULTIPLY
+			        ? reduce<Arithmetic, Operation::MULTIPLY>( problems[i], overflow )
+			        : reduce<Arithmetic, Operation::ADD>( problems[i], overflow ),
+			    overflow );
 		}
+		return total;
 	}
 
-	return problems;
-}
+	// Problems per task: enough to amortize queueing, small enough to leave every worker several chunks.
+	inline constexpr size_t problem_grain = 1 << 12;
 
-std::vector<Problem> parse_file_col( std::string_view file )
-{
-	auto [lines, problems] = parse_common( file );
+	// Sums the answers of every problem, a chunk of problems per task when there is a pool.
+	template <typename Arithmetic>
+	typename Arithmetic::value_type compute_result( tasks::ThreadPool *pool, const Problems &problems )
+	{
+		// A chunk's sum, and whether computing it overflowed.
+		using Partial = std::pair<typename Arithmetic::value_type, bool>;
+		auto [total, overflow] = tasks::parallel_reduce_chunks(
+		    pool, problems.size(), Partial{ 0, false },
+		    []( Partial acc, const Partial &chunk ) {
+			    Arithmetic::add( acc.first, chunk.first, acc.second );
+			    acc.second |= chunk.second;
+			    return acc;
+		    },
+		    [&]( size_t first, size_t last ) {
+			    Partial chunk{ 0, false };
+			    chunk.first = evaluate<Arithmetic>( problems, first, last, chunk.second );
+			    return chunk;
+		    },
+		    problem_grain );
+		Arithmetic::check( overflow );
+		return total;
+	}
 
-	size_t counter = 0;
-	for( size_t i = 0; i < lines[0].size(); ++i )
+	// Row r of the worksheet holds number r of every problem, so each row is scattered with a stride of the row count.
+	Problems parse_file( std::string_view file, std::pmr::memory_resource *resource )
 	{
-		size_t num = 0;
-		size_t pow10 = 1;
-		for( size_t j = lines.size() - 1; j-- > 0; )
+		auto [lines, problems] = parse_common( file, resource );
+
+		const size_t rows = lines.size() - 1;
+		const size_t count = problems.size();
+		problems.numbers.resize( count * rows );
+		std::pmr::vector<uint64_t> row( count, resource );
+		for( size_t r = 0; r < rows; ++r )
 		{
-			char c = lines[j][i];
-			if( c == ' ' )
+			if( integer::parse_records( tokenizer::tokens( lines[r], ' ' ), std::span( row ) ).value() != count )
 			{
-				continue;
+				throw std::runtime_error( "Invalid input" );
 			}
-			else if( c >= '0' && c <= '9' )
+			for( size_t i = 0; i < count; ++i )
 			{
-				num += ( c - '0' ) * pow10;
-				pow10 *= 10;
+				problems.numbers[i * rows + r] = row[i];
 			}
 		}
-		if( num > 0 )
+		for( size_t i = 1; i <= count; ++i )
 		{
-			problems[counter].numbers.push_back( num );
+			problems.offsets.push_back( i * rows );
 		}
-		else
+
+		// Moved explicitly: a structured binding is copied on return, and a copy would leave the arena.
+		return std::move( problems );
+	}
+
+	// Columns per tile of the vertical parse: one tile of every digit row plus its accumulators stays in L1.
+	inline constexpr size_t column_tile = 512;
+
+	// Folds one row into the column numbers it sits above, Horner style: columns[c] = columns[c] * 10 + digit
+	// wherever the row holds a digit. Branchless, so the compiler vectorizes it across columns.
+	inline void accumulate_digits( const char *row, size_t n, uint64_t *columns )
+	{
+		for( size_t c = 0; c < n; ++c )
 		{
-			counter++;
+			const uint64_t digit = static_cast<unsigned char>( row[c] - '0' );
+			columns[c] = digit <= 9 ? columns[c] * 10 + digit : columns[c];
 		}
 	}
 
-	return problems;
-}
+	// Reads the numbers down the columns. Rather than walking each column through every row, which strides across
+	// the whole width per digit, the digit rows are transposed one tile of columns at a time: every row streams its
+	// slice of the tile into the accumulators, then the finished tile is emitted left to right. A column without
+	// digits separates two problems.
+	Problems parse_file_col( std::string_view file, std::pmr::memory_resource *resource )
+	{
+		auto [lines, problems] = parse_common( file, resource );
 
-int main( int argc, char *argv[] )
-{
-	args::Parser parser( argc, argv );
-	auto file1 = reader::read_file<std::string>( parser.get_or( "file", "day6/in.txt" ) );
+		const auto digits = std::span( lines ).first( lines.size() - 1 );
+		const size_t width = std::ranges::fold_left(
+		    digits, size_t{ 0 }, []( size_t acc, std::string_view line ) { return std::max( acc, line.size() ); } );
+		problems.numbers.reserve( width );
+
+		std::array<uint64_t, column_tile> columns;
+		for( size_t first = 0; first < width; first += column_tile )
+		{
+			const size_t n = std::min( column_tile, width - first );
+			std::fill_n( columns.begin(), n, 0 );
+			for( std::string_view line : digits )
+			{
+				if( line.size() > first )
+				{
+					accumulate_digits( line.data() + first, std::min( n, line.size() - first ), columns.data() );
+				}
+			}
+
+			for( size_t c = 0; c < n; ++c )
+			{
+				if( columns[c] > 0 )
+				{
+					problems.numbers.push_back( columns[c] );
+				}
+				else if( problems.open() )
+				{
+					problems.close();
+				}
+			}
+		}
+		if( problems.open() )
+		{
+			problems.close();
+		}
+		if( problems.offsets.size() != problems.size() + 1 )
+		{
+			throw std::runtime_error( "Invalid input" );
+		}
+
+		return std::move( problems );
+	}
+
+	// The worksheet is read twice while parsing: across the rows for part 1, down the columns for part 2.
+	struct Worksheet
+	{
+		Problems rows;
+		Problems columns;
+	};
+
+	// --threads above 1 evaluates the problems on a work-stealing pool. --checked computes in 128 bits and fails on
+	// overflow instead of wrapping like the default 64-bit answers.
+	class Solution : public solver::Solver
+	{
+	  public:
+		explicit Solution( const args::Parser &parser )
+		    : checked_( parser.has( "checked" ) )
+		    , pool_( tasks::make_pool( parser ) )
+		{
+		}
+
+		void parse( std::string_view input ) override
+		{
+			worksheet_ = arena::Region<Worksheet>( 4 * input.size(), [&]( std::pmr::memory_resource *resource ) {
+				return Worksheet{ parse_file( input, resource ), parse_file_col( input, resource ) };
+			} );
+		}
+
+		std::string part1() override { return answer( worksheet_->rows ); }
+
+		std::string part2() override { return answer( worksheet_->columns ); }
+
+		std::optional<arena::Stats> allocations() const override { return worksheet_.stats(); }
+
+		// Both readings of the worksheet, three sections each.
+		uint32_t cache_layout() const override { return 1; }
+
+		bool save( cache::Writer &writer ) const override
+		{
+			for( const Problems *problems : { &worksheet_->rows, &worksheet_->columns } )
+			{
+				writer.add( std::span<const uint64_t>( problems->numbers ) );
+				writer.add( std::span<const size_t>( problems->offsets ) );
+				writer.add( std::span<const Operation>( problems->operations ) );
+			}
+			return true;
+		}
+
+		bool load( const cache::Reader &reader ) override
+		{
+			if( reader.sections() != 6 )
+				return false;
+			size_t bytes = 0;
+			for( size_t i = 0; i < reader.sections(); ++i )
+			{
+				bytes += reader.section<std::byte>( i )->size();
+			}
+			bool valid = true;
+			worksheet_ = arena::Region<Worksheet>( bytes, [&]( std::pmr::memory_resource *resource ) {
+				auto problems = [&]( size_t first ) {
+					Problems result( resource );
+					auto numbers = reader.section<uint64_t>( first );
+					auto offsets = reader.section<size_t>( first + 1 );
+					auto operations = reader.section<Operation>( first + 2 );
+					// Offsets that do not run from 0 up to the end of the numbers would index past them.
+					if( !numbers || !offsets || !operations || offsets->size() != operations->size() + 1 ||
+					    offsets->front() != 0 || !std::ranges::is_sorted( *offsets ) ||
+					    offsets->back() != numbers->size() )
+					{
+						valid = false;
+						return result;
+					}
+					result.numbers.assign( numbers->begin(), numbers->end() );
+					result.offsets.assign( offsets->begin(), offsets->end() );
+					result.operations.assign( operations->begin(), operations->end() );
+					return result;
+				};
+				return Worksheet{ problems( 0 ), problems( 3 ) };
+			} );
+			return valid;
+		}
+
+	  private:
+		std::string answer( const Problems &problems )
+		{
+			if( checked_ )
+			{
+#ifdef __SIZEOF_INT128__
+				return to_string( compute_result<Checked>( pool_.get(), problems ) );
+#else
+				throw std::runtime_error( "--checked needs a compiler with 128-bit integers" );
+#endif
+			}
+			return std::to_string( compute_result<Wrapping>( pool_.get(), problems ) );
+		}
+
+		bool checked_;
+		std::unique_ptr<tasks::ThreadPool> pool_;
+		arena::Region<Worksheet> worksheet_;
+	};
 
-	std::println( "Part1 {} ", compute_result( parse_file( file1.value() ) ) );
-	std::println( "Part2 {} ", compute_result( parse_file_col( file1.value() ) ) );
+} // namespace day6
 
-	return 0;
-}
+AOC_SOLVER( day6, day6::Solution );
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+
+// Writes through a fixed-size buffer, so multi-gigabyte inputs never have to fit in memory.
+class Output
+{
+  public:
+	explicit Output( std::ostream &stream )
+	    : stream_( stream )
+	{
+		buffer_.reserve( flush_size );
+	}
+
+	~Output() { flush(); }
+
+	Output &operator<<( std::string_view text )
+	{
+		buffer_ += text;
+		if( buffer_.size() >= flush_size )
+			flush();
+		return *this;
+	}
+
+	Output &operator<<( char c ) { return *this << std::string_view( &c, 1 ); }
+
+	Output &operator<<( uint64_t value )
+	{
+		char digits[20];
+		auto result = std::to_chars( std::begin( digits ), std::end( digits ), value );
+		return *this << std::string_view( digits, result.ptr );
+	}
+
+	void flush()
+	{
+		stream_.write( buffer_.data(), static_cast<std::streamsize>( buffer_.size() ) );
+		buffer_.clear();
+	}
+
+  private:
+	static constexpr size_t flush_size = 1 << 20;
+
+	std::ostream &stream_;
+	std::string buffer_;
+};
+
+template <typename Engine> uint64_t uniform( Engine &rng, uint64_t min, uint64_t max )
+{
+	return std::uniform_int_distribution<uint64_t>( min, max )( rng );
+}
+
+// SplitMix64: a generator that is cheap to seed, for values that are regenerated from their own seed instead of
+// being kept.
+class SplitMix64
+{
+  public:
+	using result_type = uint64_t;
+
+	explicit SplitMix64( uint64_t seed )
+	    : state_( seed )
+	{
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()()
+	{
+		uint64_t z = ( state_ += 0x9E3779B97F4A7C15 );
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EB;
+		return z ^ ( z >> 31 );
+	}
+
+  private:
+	uint64_t state_;
+};
+
+uint64_t size_or( const args::Parser &parser, uint64_t default_size )
+{
+	return parser.get<uint64_t>( "size" ).value_or( default_size );
+}
+
+// --size dial steps of up to --max-distance clicks.
+void generate_day1( Output &out, const args::Parser &parser, std::mt19937_64 &rng )
+{
+	const uint64_t steps = size_or( parser, 1'000'000 );
+	const uint64_t max_distance = parser.get<uint64_t>( "max-distance" ).value_or( 999 );
+	for( uint64_t i = 0; i < steps; ++i )
+	{
+		out << ( uniform( rng, 0, 1 ) ? 'L' : 'R' ) << uniform( rng, 1, max_distance ) << '\n';
+	}
+}
+
+// --size ranges up to --width ids wide, starting anywhere from 1 to 18 digits.
+void generate_day2( Output &out, const args::Parser &parser, std::mt19937_64 &rng )
+{
+	const uint64_t ranges = size_or( parser, 1'000 );
+	const uint64_t width = parser.get<uint64_t>( "width" ).value_or( 1'000'000'000 );
+	for( uint64_t i = 0; i < ranges; ++i )
+	{
+		uint64_t limit = 1;
+		for( uint64_t digits = uniform( rng, 1, 18 ); digits > 0; --digits )
+		{
+			limit *= 10;
+		}
+		const uint64_t first = uniform( rng, 1, limit - 1 );
+		const uint64_t headroom = std::numeric_limits<uint64_t>::max() - first;
+		const uint64_t last = first + std::min( uniform( rng, 0, width ), headroom );
+		out << ( i == 0 ? "" : "," ) << first << '-' << last;
+	}
+}
+
+// --size packs of --length digits each.
+void generate_day3( Output &out, const args::Parser &parser, std::mt19937_64 &rng )
+{
+	const uint64_t packs = size_or( parser, 1'000 );
+	const uint64_t length = parser.get<uint64_t>( "length" ).value_or( 10'000 );
+	std::string line( length, '0' );
+	for( uint64_t i = 0; i < packs; ++i )
+	{
+		std::ranges::generate( line, [&] { return static_cast<char>( '0' + uniform( rng, 1, 9 ) ); } );
+		out << line << '\n';
+	}
+}
+
+// A --size x --size map where each cell holds a roll with probability --density.
+void generate_day4( Output &out, const args::Parser &parser, std::mt19937_64 &rng )
+{
+	const uint64_t side = size_or( parser, 1'000 );
+	std::bernoulli_distribution roll( parser.get<double>( "density" ).value_or( 0.6 ) );
+	std::string line( side, '.' );
+	for( uint64_t y = 0; y < side; ++y )
+	{
+		std::ranges::generate( line, [&] { return roll( rng ) ? '@' : '.'; } );
+		out << line << '\n';
+	}
+}
+
+// --size fresh ranges up to --width ids wide, then --queries ingredient ids (10 per range by default).
+void generate_day5( Output &out, const args::Parser &parser, std::mt19937_64 &rng )
+{
+	constexpr uint64_t max_id = 500'000'000'000'000;
+	const uint64_t ranges = size_or( parser, 100'000 );
+	const uint64_t queries = parser.get<uint64_t>( "queries" ).value_or( 10 * ranges );
+	const uint64_t width = parser.get<uint64_t>( "width" ).value_or( 1'000'000'000'000 );
+	for( uint64_t i = 0; i < ranges; ++i )
+	{
+		const uint64_t first = uniform( rng, 1, max_id );
+		out << first << '-' << first + uniform( rng, 0, width ) << '\n';
+	}
+	out << '\n';
+	for( uint64_t i = 0; i < queries; ++i )
+	{
+		out << uniform( rng, 1, max_id ) << '\n';
+	}
+}
+
+// --size problems side by side, each with --rows numbers of up to --digits digits over its operator.
+// Digits are never 0, so every column of a problem reads as a non-zero vertical number.
+// Rows are written one at a time: each number is drawn from a seed of its own, once to size its problem's column
+// and again when its row is written, so only the widths and alignments are kept.
+void generate_day6( Output &out, const args::Parser &parser, std::mt19937_64 &rng )
+{
+	const uint64_t problems = size_or( parser, 100'000 );
+	const uint64_t rows = parser.get<uint64_t>( "rows" ).value_or( 4 );
+	const uint64_t max_digits = parser.get<uint64_t>( "digits" ).value_or( 4 );
+	const uint64_t seed = rng();
+	auto number_rng = [&]( uint64_t p, uint64_t r ) { return SplitMix64( seed ^ ( p * rows + r ) ); };
+
+	std::vector<size_t> widths( problems, 0 );
+	std::vector<bool> right_aligned( problems );
+	for( uint64_t p = 0; p < problems; ++p )
+	{
+		right_aligned[p] = uniform( rng, 0, 1 );
+		for( uint64_t r = 0; r < rows; ++r )
+		{
+			auto digits_rng = number_rng( p, r );
+			widths[p] = std::max<size_t>( widths[p], uniform( digits_rng, 1, max_digits ) );
+		}
+	}
+
+	std::string number;
+	for( uint64_t r = 0; r < rows; ++r )
+	{
+		for( uint64_t p = 0; p < problems; ++p )
+		{
+			auto digits_rng = number_rng( p, r );
+			number.resize( uniform( digits_rng, 1, max_digits ) );
+			std::ranges::generate( number, [&] { return static_cast<char>( '0' + uniform( digits_rng, 1, 9 ) ); } );
+			const std::string padding( widths[p] - number.size(), ' ' );
+			out << ( p == 0 ? "" : " " ) << ( right_aligned[p] ? padding : number )
+			    << ( right_aligned[p] ? number : padding );
+		}
+		out << '\n';
+	}
+	for( uint64_t p = 0; p < problems; ++p )
+	{
+		out << ( p == 0 ? "" : " " ) << ( uniform( rng, 0, 1 ) ? '+' : '*' ) << std::string( widths[p] - 1, ' ' );
+	}
+}
+
+int main( int argc, char *argv[] )
+{
+	args::Parser parser( argc, argv );
+
+	const std::map<std::string, std::function<void( Output &, const args::Parser &, std::mt19937_64 & )>> generators = {
+		{ "day1", generate_day1 }, { "day2", generate_day2 }, { "day3", generate_day3 },
+		{ "day4", generate_day4 }, { "day5", generate_day5 }, { "day6", generate_day6 },
+	};
+
+	auto day = parser.get( 0 );
+	if( !day || !generators.contains( *day ) )
+	{
+		std::println( stderr, "usage: generator <day1..day6> [--size <n>] [--seed <s>] [--out <path>]" );
+		return 1;
+	}
+
+	std::mt19937_64 rng( parser.get<uint64_t>( "seed" ).value_or( 2025 ) );
+
+	std::ofstream file;
+	std::ostream *stream = &std::cout;
+	if( auto path = parser.get( "out" ) )
+	{
+		file.open( *path, std::ios::out | std::ios::binary );
+		if( !file )
+		{
+			std::println( stderr, "cannot open {}", *path );
+			return 1;
+		}
+		stream = &file;
+	}
+
+	Output out( *stream );
+	generators.at( *day )( out, parser, rng );
+	return 0;
+}
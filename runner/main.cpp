@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <expected>
+#include <format>
+#include <map>
+#include <memory>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// One day's run: its answers and timings, or why it has none.
+struct Outcome
+{
+	const solver::Registration *day = nullptr;
+	std::string path;
+	std::optional<solver::Result> result;
+	std::string error;
+	std::unique_ptr<bench::Session> session;
+};
+
+struct Input
+{
+	std::expected<reader::FileView, reader::ReadError> file = std::unexpected( reader::ReadError::FileNotFound );
+	double read_ms = 0;
+};
+
+int main( int argc, char *argv[] )
+{
+	args::Parser parser( argc, argv );
+
+	// Every registered day by default, or just the ones named on the command line. Empty names are skipped, as the
+	// pixi task passes its unused arguments through as "".
+	std::vector<std::string> names;
+	for( size_t i = 0; i < parser.count(); ++i )
+	{
+		if( auto name = *parser.get( i ); !name.empty() )
+		{
+			names.push_back( name );
+		}
+	}
+
+	std::vector<Outcome> outcomes;
+	if( names.empty() )
+	{
+		for( const auto &day : solver::registry() )
+		{
+			outcomes.push_back( { &day } );
+		}
+		std::ranges::sort( outcomes, {}, []( const Outcome &outcome ) { return outcome.day->name; } );
+	}
+	for( const auto &name : names )
+	{
+		const solver::Registration *day = solver::find( name );
+		if( !day )
+		{
+			std::println( stderr, "unknown day {}", name );
+			return 1;
+		}
+		outcomes.push_back( { day } );
+	}
+
+	// --dayN <path> overrides a day's input; days given the same file share one read of it. With --read stream, the
+	// days that stream read their own input while they parse it instead.
+	const reader::ReadOptions options = reader::read_options( parser );
+	auto streams = [&]( const Outcome &outcome ) {
+		return options.mode == reader::ReadMode::Streamed && outcome.day->streams;
+	};
+	std::map<std::string, Input> inputs;
+	for( auto &outcome : outcomes )
+	{
+		outcome.path = parser.get_or( outcome.day->name, outcome.day->default_input() );
+		if( !streams( outcome ) )
+		{
+			inputs.try_emplace( outcome.path );
+		}
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	tasks::ThreadPool pool( tasks::thread_count( parser, 0 ) );
+	for( auto &[path, input] : inputs )
+	{
+		pool.submit( [&] {
+			auto read_start = std::chrono::steady_clock::now();
+			input.file = reader::read_file<reader::FileView>( path, options );
+			input.read_ms =
+			    std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - read_start ).count();
+		} );
+	}
+	pool.wait();
+
+	// The days run side by side on this pool, so each day's own pool gets its share of the threads rather than
+	// --threads more of them.
+	tasks::pool_limit() = std::max<size_t>( pool.size() / std::max<size_t>( outcomes.size(), 1 ), 1 );
+	for( auto &outcome : outcomes )
+	{
+		pool.submit( [&] {
+			const Input *input = streams( outcome ) ? nullptr : &inputs.at( outcome.path );
+			if( input && !input->file )
+			{
+				outcome.error = std::format( "cannot read {}", outcome.path );
+				return;
+			}
+			// Created on the thread that runs the day, so --profile counts that thread.
+			outcome.session = std::make_unique<bench::Session>( parser, outcome.day->name );
+			try
+			{
+				outcome.result =
+				    input ? solver::solve( *outcome.day, input->file->view(), parser, *outcome.session, outcome.path )
+				          : solver::solve( *outcome.day, solver::chunk_feed( outcome.path, options ), parser,
+				                           *outcome.session );
+			}
+			catch( const std::exception &e )
+			{
+				outcome.error = e.what();
+			}
+		} );
+	}
+	pool.wait();
+	const double total_ms =
+	    std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+	bool failed = false;
+	std::println(
+	    "{:<6} {:>20} {:>20} {:>10} {:>10} {:>10} {:>10}", "day", "part 1", "part 2", "read ms", "parse ms",
+	    "part 1 ms", "part 2 ms" );
+	for( const auto &outcome : outcomes )
+	{
+		if( !outcome.result )
+		{
+			std::println( "{:<6} {}", outcome.day->name, outcome.error );
+			failed = true;
+			continue;
+		}
+		const solver::Result &result = *outcome.result;
+		// A streamed day reads during its parse, which its parse time already includes.
+		const double read_ms = streams( outcome ) ? 0.0 : inputs.at( outcome.path ).read_ms;
+		std::println(
+		    "{:<6} {:>20} {:>20} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}", result.name, result.part1, result.part2,
+		    read_ms, result.parse_ms, result.part1_ms, result.part2_ms );
+	}
+	std::println( "{} days in {:.3f} ms on {} threads", outcomes.size(), total_ms, pool.size() );
+	for( const auto &outcome : outcomes )
+	{
+		if( outcome.result )
+		{
+			solver::print_allocations( parser, *outcome.result );
+		}
+	}
+
+	for( const auto &outcome : outcomes )
+	{
+		if( outcome.session )
+		{
+			outcome.session->report();
+		}
+	}
+	return failed ? 1 : 0;
+}
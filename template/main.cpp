@@ -1,12 +1,30 @@
-#include <expected>
 #include <print>
+#include <string>
+#include <string_view>
 
 #include "common.hpp"
 
-int main( int argc, char *argv[] )
+// Skeleton for a new day: copy to dayN/main.cpp, rename the namespace, fill in the three methods, and add dayN to
+// AOC2025_DAYS in CMakeLists.txt so the aoc runner picks it up.
+namespace dayN
 {
-	args::Parser parser( argc, argv );
-	auto file = reader::read_file<std::string>( "pixi.toml" );
-	std::print( "file: {}", file.value() );
-	return 0;
-}
+
+	class Solution : public solver::Solver
+	{
+	  public:
+		// Optional: take the command line to read options of this day's own.
+		explicit Solution( const args::Parser & ) {}
+
+		void parse( std::string_view input ) override { input_ = input; }
+
+		std::string part1() override { return std::to_string( input_.size() ); }
+
+		std::string part2() override { return std::string( input_.substr( 0, input_.find( '\n' ) ) ); }
+
+	  private:
+		std::string_view input_;
+	};
+
+} // namespace dayN
+
+AOC_SOLVER( dayN, dayN::Solution );